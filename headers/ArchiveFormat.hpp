@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+//Кодиране на цели числа и блоково компресиране за компактния двоичен формат на автоматите.
+//Числата се записват като varint (по 7 бита в байт, старшият бит показва, че следва още байт), а знаковите разлики - със zigzag
+class BlockCompressor
+{
+public:
+    //Компресира блок с прост LZ77: последователност от (брой литерали, литерали, дължина на съвпадение, отместване)
+    static std::string compress(const std::string& input);
+
+    //Разкомпресира блок, който трябва да има точно rawLength байта. При повреден блок хвърля std::runtime_error
+    static std::string decompress(const std::string& input, size_t rawLength);
+};
+
+//Записва varint числа в поток. Данните се събират в блокове, които по желание се компресират поотделно,
+//така че четенето да може да става на части, без целият файл да е в паметта
+class ArchiveWriter
+{
+public:
+    ArchiveWriter(std::ostream& out, bool compress);
+
+    void writeByte(uint8_t value);
+    void writeBytes(const char* data, size_t length);
+    void writeVarint(uint64_t value);
+
+    //Записва знаково число като zigzag varint: малките по абсолютна стойност числа заемат малко байтове
+    void writeSignedVarint(int64_t value);
+
+    //Записва последния блок и маркера за край
+    void finish();
+
+    //Записва varint директно в поток, без блокове. Използва се за заглавието на файла
+    static void writeRawVarint(std::ostream& out, uint64_t value);
+
+private:
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    std::ostream& out;
+    bool compress;
+    std::string block;
+
+    void flushBlock();
+};
+
+//Чете данните, записани от ArchiveWriter, като зарежда по един блок. При непълни или повредени данни хвърля std::runtime_error
+class ArchiveReader
+{
+public:
+    explicit ArchiveReader(std::istream& in);
+
+    uint8_t readByte();
+    void readBytes(char* data, size_t length);
+    uint64_t readVarint();
+    int64_t readSignedVarint();
+
+    //Проверява, че след прочетените данни следва маркерът за край
+    void expectEnd();
+
+    static uint64_t readRawVarint(std::istream& in);
+
+private:
+    std::istream& in;
+    std::string block;
+    size_t position;
+    bool ended;
+
+    //Зарежда следващия блок. Връща false, ако е достигнат маркерът за край
+    bool loadBlock();
+};
@@ -5,16 +5,39 @@
 #include <unordered_map>
 #include <functional>
 #include <fstream>
+#include <memory>
 #include "State.hpp"
+#include "StateNames.hpp"
+
+class CompiledAutomaton;
+class NFA;
 
 class Automaton {
 public:
+    //Приблизителната памет на автомата в байтове по части. Компилираните таблици от freeze се държат отделно в CompiledAutomaton
+    //и се измерват с CompiledAutomaton::memoryUsage
+    struct MemoryUsage {
+        size_t states;   //Обектите State и масивът с указатели към тях
+        size_t edges;    //Интервалите на преходите, техните масиви от състояния и празните преходи
+        size_t names;    //Таблицата с имената. Копията на автомата я споделят до първата промяна, но всяко я отчита изцяло
+        size_t alphabet; //Множеството от символи
+        size_t caches;   //Структурите, които наследниците строят при разпознаване (например BitParallelNFA на NFA)
+
+        size_t total() const { return states + edges + names + alphabet + caches; }
+    };
+
     //Празен конструктор
     Automaton() : startState(nullptr) {}
 
-
+    //Копира състоянията, преходите и азбуката на other
     Automaton(const Automaton& other);
 
+    //Взема състоянията на other, без да ги копира. other остава празен автомат
+    Automaton(Automaton&& other) noexcept;
+
+    Automaton& operator=(const Automaton& other);
+    Automaton& operator=(Automaton&& other) noexcept;
+
     virtual ~Automaton() {
         for (State* state : states) {
             delete state;
@@ -24,15 +47,29 @@ public:
     //Добавя състояние в автомата
     State* addState(const std::string& name, bool isFinal = false);
 
+    //Добавя състояние без име. Показва се като q<индекс>. Алгоритмите създават състоянията си така, без да строят низове
+    State* addUnnamedState(bool isFinal = false);
+
+    //Връща името на състоянието. Имената на състоянията, получени от операции (например двойките при сечение), се строят едва сега
+    std::string getStateName(const State* state) const;
+
+    //Задава име на състоянието
+    void setStateName(State* state, const std::string& name);
+
     //Задава кое е началното състояние
     void setStartState(State* state) {
         startState = state;
+        onChange();
     }
 
     //Добавя преход в автомата
     virtual void addTransition(State* source, char symbol, State* destination) = 0;
 
-    //Проверява дали дума се разпознава от автомата
+    //Добавя преход с всички символи от интервала [low, high] като едно ребро
+    virtual void addRangeTransition(State* source, unsigned char low, unsigned char high, State* destination) = 0;
+
+    //Проверява дали дума се разпознава от автомата. Не променя автомата, затова може да се извиква едновременно от много нишки,
+    //докато никоя нишка не променя автомата. За разпознаване, докато автоматът се заменя, се използват freeze и SharedAutomaton
     virtual bool accepts(const std::string& input) const = 0;
 
     friend bool operator>>(Automaton& fa, const std::string& input)
@@ -43,16 +80,16 @@ public:
     //Описва автомата в стандартния изход
     void print() const;
 
-    //Връща обект от тип vector, съдържащ състоянията на автомата
-    std::vector<State*> getStates() const {
+    //Връща състоянията на автомата, подредени по State::id, без да ги копира
+    const std::vector<State*>& getStates() const {
         return states;
     }
 
     //Връша указател към началното състояние на автомата
     State* getStartState() const { return startState; }
 
-    //Връща състоянията, достижими от дадено състояние след преход с даден симбол
-    std::vector<State*> getNextStates(State* state, char symbol) const;
+    //Връща състоянията, достижими от дадено състояние след преход с даден симбол, без да ги копира
+    const std::vector<State*>& getNextStates(State* state, char symbol) const;
 
     //Връша азбуката на автомата
     const std::unordered_set<char>& getAlphabet() const;
@@ -60,6 +97,9 @@ public:
     //Връща броя на състоянията на автомата
     size_t getStateCount()const;
 
+    //Връща колко памет заема автоматът
+    MemoryUsage memoryUsage()const;
+
     //Чисти масивът, съдържащ състоянията на автомата. Освобождава и динамичната памет
     void clearStates();
 
@@ -69,6 +109,25 @@ public:
     //Добавя символ към азбуката на автомата
     void addSymbolToAlphabet(char c);
 
+    //Добавя всички символи от интервала [low, high] към азбуката на автомата
+    void addRangeToAlphabet(unsigned char low, unsigned char high);
+
+    //Разделя символите на интервали, в рамките на които всички преходи на this и other (ако е подаден) се държат еднакво.
+    //Връща само интервалите, които участват в поне един преход. Алгоритмите обхождат тях вместо цялата азбука
+    std::vector<SymbolRange> getSymbolClasses(const Automaton* other = nullptr) const;
+
+    //Връща за всяко състояние (по индекс) дали е достижимо от началното и дали от него се достига финално състояние.
+    //Изчислява се с права и обратна BFS по индексите на състоянията
+    std::vector<bool> getUsefulStates() const;
+
+    //Премахва състоянията, които не са достижими от началното или от които не се достига финално, заедно с преходите към тях.
+    //След това липсващ преход означава, че думата вече не може да бъде разпозната, и разпознаването спира веднага. При празен език остава само началното състояние, без преходи.
+    //Връща броя на премахнатите състояния
+    size_t trim();
+
+    //Връща етикета на интервал от символи: самият символ или [low-high]
+    static std::string rangeToString(unsigned char low, unsigned char high);
+
     //Копира състоянията в нов автомат като пълни map с ключ оригиналното състояние, по който да могат да се добавят преходите.
     //Има включена функция като параметър, която се изпълнява върху всяко състояние при копирането
     void copyStates(const Automaton& source, Automaton& target,
@@ -78,18 +137,52 @@ public:
     //Копира преходите от source в target, използвайки предварително попълнен map на състоянията
     virtual void copyTransitions(const Automaton& source, Automaton& target, std::unordered_map<State*, State*>& stateMap)const;
 
-    //Запазва автомата във файл в двоичен вид
-    void saveToFile(const std::string& fileName)const;
+    //Връща автомат, който разпознава обърнатите думи от езика на this: преходите са обърнати, финалните състояния стават начални
+    //(чрез ново начално състояние с празни преходи, ако са повече от едно), а началното - финално. Имената на състоянията се запазват
+    NFA reverse()const;
 
-    //Зарежда автомата от файл
+    //Връща неизменимо компактно копие на автомата, което може да се споделя между нишки и да се публикува в SharedAutomaton.
+    //Последващи промени по this не го засягат
+    std::shared_ptr<const CompiledAutomaton> freeze()const;
+
+    //Запазва автомата във файл в компактния двоичен формат на CompiledAutomaton, заедно с имената на състоянията.
+    //Ако compress е true, данните се компресират на блокове
+    void saveToFile(const std::string& fileName, bool compress = true)const;
+
+    //Зарежда автомата от файл, записан със saveToFile. Състоянията без име получават имена q0, q1, ...
     void loadFromFile(const std::string& fileName);
 
-    //Създава dot и png файл на автомата, използвайки Graphviz, след това го отваря
+    //Създава output.dot и output.png в текущата директория, използвайки Graphviz, след това отваря изображението
     void vizualize()const;
 
-    //Създава dot и png файл на автомата, използвайки Graphviz 
+    //Създава fileName.dot и fileName.png, използвайки Graphviz. fileName е път без разширение, напр. "out/automaton"
     void saveAsPng(const std::string& fileName)const;
 
+    //Записва автомата в dot формат във файл, поток или файлов дескриптор. Успоредните ребра между две състояния се обединяват
+    //в едно ребро с етикет от интервали. Ако maxStates не е 0, се показват само първите maxStates състояния в реда на BFS,
+    //а останалите се събират в един възел
+    void exportGraphviz(const std::string& fileName, size_t maxStates = 0)const;
+    void exportGraphviz(std::ostream& out, size_t maxStates = 0)const;
+    void exportGraphviz(int fileDescriptor, size_t maxStates = 0)const;
+
+protected:
+    //Добавя състояние, което носи името на състоянието state от автомата source
+    State* addDerivedState(const Automaton& source, const State* state, bool isFinal);
+
+    //Добавя състояние за двойката (left, right) от автоматите leftSource и rightSource. Името му е "ляво_дясно"
+    State* addPairState(const Automaton& leftSource, const State* left, const Automaton& rightSource, const State* right, bool isFinal);
+
+    //Извиква се при всяка промяна на състоянията или преходите през методите на автомата. Наследниците изчистват в нея кешовете си.
+    //Промените направо през State (например State::addTransition или isFinal) не я извикват
+    virtual void onChange() {}
+
+    //Паметта на кешовете, изчиствани в onChange
+    virtual size_t cacheMemoryUsage() const { return 0; }
+
+    //Премества състоянията на other в края на този автомат и обединява азбуките. Указателите към преместените състояния остават валидни,
+    //а other остава празен. Използва се от операциите, които получават автомат, който вече не е нужен
+    void absorbStates(Automaton&& other);
+
 private:
     //Масив от указатели към състоянията на автомата
     std::vector<State*> states;
@@ -100,7 +193,25 @@ private:
     //Множество, представляващо азбуката на автомата
     std::unordered_set<char> alphabet;
 
-    //Генерира Graphviz файл, описващ насочен граф, представляващ автомата
-    void generateGraphvizFile(const std::string& fileName)const;
+    //Имената на състоянията. Копията на автомата и резултатите от операции споделят таблицата и я копират едва при промяна
+    std::shared_ptr<StateNames> names;
+
+    //Връща таблицата с имената за промяна. Ако е споделена, първо се копира
+    StateNames& editNames();
+
+    //Връща таблицата с имената за използване като източник на имена в друг автомат
+    std::shared_ptr<const StateNames> sharedNames() const;
+
+    //Създава състояние и го добавя в масива. Етикетът за името се добавя от извикващия
+    State* pushState(bool isFinal);
+
+    //Добавя копия на състоянията и преходите на other към празен автомат и копира азбуката му
+    void copyFrom(const Automaton& other);
+
+    //Генерира описание на автомата по синтаксиса на Graphviz и го подава на write на блокове
+    void writeGraphviz(const std::function<void(const char*, size_t)>& write, size_t maxStates)const;
+
+    //Стартира програма с дадените аргументи без команден интерпретатор. Връща дали е стартирана (и завършила успешно, ако wait е true)
+    static bool runProgram(const std::vector<std::string>& arguments, bool wait);
 
 };
\ No newline at end of file
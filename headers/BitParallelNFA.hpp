@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "NFA.hpp"
+
+/*Побитова симулация на недетерминиран автомат с малко състояния. Активните състояния се пазят като битове в 64-битови думи.
+Изисква всички преходи със символ, влизащи в едно състояние, да имат еднакъв етикет (така е за автоматите на Томпсън и на Глушков от RegexToNFA).
+Тогава една стъпка е: следващите = follow(активните) & маската на символа, последвано от затваряне по празните преходи.
+follow и затварянето са таблици, индексирани с всеки 8 бита от активното множество, затова стъпката не зависи от броя активни състояния
+и не заделя памет*/
+class BitParallelNFA
+{
+public:
+    //Максималният брой състояния, за които се строи побитовата симулация
+    static const size_t MAX_STATES = 512;
+
+    //Строи побитовата симулация. Връща nullptr, ако автоматът има твърде много състояния или преходите му не отговарят на изискването по-горе.
+    //Таблиците се отчитат в MemoryLimit
+    static std::unique_ptr<BitParallelNFA> fromNFA(const NFA& nfa);
+
+    //Връща true, ако автоматът разпознава думата
+    bool accepts(const std::string& input) const;
+
+    size_t getStateCount() const { return stateCount; }
+
+    //Приблизителната памет на таблиците в байтове
+    size_t memoryUsage() const;
+
+    //Потоково разпознаване: думата се подава на части, а текущото множество от състояния се пази между тях
+    class Matcher
+    {
+    public:
+        explicit Matcher(const BitParallelNFA& automaton);
+
+        //Връща се в началното множество от състояния
+        void reset();
+
+        //Обработва следващата част от входа
+        void feed(const char* data, size_t length);
+        void feed(const std::string& data) { feed(data.data(), data.size()); }
+
+        //Дали прочетеното досега се разпознава
+        bool isAccepting() const;
+
+        //Дали няма активни състояния. Тогава никое продължение не може да бъде разпознато
+        bool isDead() const;
+
+    private:
+        const BitParallelNFA& automaton;
+        std::vector<uint64_t> active;
+        std::vector<uint64_t> next;
+        std::vector<uint64_t> scratch;
+    };
+
+private:
+    BitParallelNFA(size_t stateCount);
+
+    size_t stateCount;
+    size_t words; //Брой 64-битови думи в едно множество
+    size_t chunks; //Брой 8-битови части в едно множество
+    bool hasEpsilon;
+
+    //Класът на всеки символ. Клас 0 са символите без преходи
+    std::array<uint16_t, 256> classOf;
+
+    //symbolMasks[k] е множеството от състояния, в които се влиза със символ от клас k
+    std::vector<uint64_t> symbolMasks;
+
+    //followTable[j][b] е множеството от състояния, достижими с един преход (без значение символа) от състоянията 8j..8j+7, зададени с битовете на b
+    std::vector<uint64_t> followTable;
+
+    //closureTable[j][b] е затварянето по празни преходи на състоянията 8j..8j+7, зададени с битовете на b
+    std::vector<uint64_t> closureTable;
+
+    std::vector<uint64_t> startMask;
+    std::vector<uint64_t> finalMask;
+
+    //Попълва таблица от вида followTable по множествата за отделните състояния
+    void buildChunkTable(const std::vector<uint64_t>& single, std::vector<uint64_t>& table) const;
+
+    //Изчислява next от active след прочитане на символа c. scratch е работна памет със същия размер
+    void step(const uint64_t* active, uint64_t* next, uint64_t* scratch, unsigned char c) const;
+
+    //Записва в result обединението на редовете от таблицата за всяка ненулева 8-битова част на set
+    void lookup(const std::vector<uint64_t>& table, const uint64_t* set, uint64_t* result) const;
+
+    bool intersects(const uint64_t* set, const std::vector<uint64_t>& mask) const;
+};
@@ -0,0 +1,224 @@
+﻿#pragma once
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Automaton.hpp"
+#include "SparseSet.hpp"
+
+/*Компактно представяне на автомат без обекти State: състоянията са индекси, а символите са разделени на класове на еквивалентност
+(символи, с които всички състояния имат еднакви преходи). Преходите са в CSR масиви, подредени по клас и после по целево състояние.
+За детерминирани автомати се строи и плътна таблица state * classCount + class. Ако състоянията са по-малко от 65535,
+индексите в нея са uint16_t, за да заема таблицата наполовина по-малко кеш. Голяма таблица с малко преходи на ред (например
+за речник от думи) се заменя с компресирана (comb) таблица, в която редовете са разместени така, че да се застъпват.
+Записва се и се зарежда в компактен двоичен формат, без да се създават State обекти.
+Обектът не се променя след създаването си, затова може да се споделя (чрез shared_ptr, виж Automaton::freeze) и да се използва
+едновременно от произволен брой нишки без синхронизация. Всяка нишка разпознава с accepts или със собствен Matcher*/
+class CompiledAutomaton
+{
+public:
+    //Липсващо състояние в таблицата на преходите
+    static constexpr uint32_t NO_STATE = UINT32_MAX;
+
+    //Строи представянето от автомат. Индексите на състоянията съвпадат с State::id
+    explicit CompiledAutomaton(const Automaton& automaton);
+
+    //Връща true, ако автоматът разпознава думата. За детерминирани автомати не заделя памет
+    bool accepts(const std::string& input) const { return accepts(input.data(), input.size()); }
+    bool accepts(const char* input, size_t length) const;
+
+    /*Разпознава дълъг вход на няколко нишки. Входът се разделя на части и за всяка част (освен първата) се пресмята функцията
+    "начално състояние -> крайно състояние", като се симулират едновременно всички състояния. Симулациите, които стигнат
+    до едно и също състояние, се сливат, затова обикновено след малко символи остават няколко. Накрая функциите се композират
+    по ред. За недетерминирани автомати, автомати с повече от PARALLEL_MAX_STATES състояния и кратък вход разпознава последователно.
+    threadCount 0 означава std::thread::hardware_concurrency()*/
+    bool acceptsParallel(const std::string& input, unsigned threadCount = 0) const { return acceptsParallel(input.data(), input.size(), threadCount); }
+    bool acceptsParallel(const char* input, size_t length, unsigned threadCount = 0) const;
+
+    //Потоково разпознаване с памет, заделена веднъж при създаването. Matcher държи автомата жив, докато се използва,
+    //затова замяната на автомата в SharedAutomaton не засяга започнатите разпознавания. Един Matcher се използва от една нишка.
+    //Matcher без автомат (например от SharedAutomaton, в който още нищо не е публикувано) е мъртъв и не разпознава нищо
+    class Matcher
+    {
+    public:
+        explicit Matcher(std::shared_ptr<const CompiledAutomaton> automaton);
+
+        //Връща се в началното състояние
+        void reset();
+
+        //Обработва следващата част от входа
+        void feed(const char* data, size_t length);
+        void feed(const std::string& data) { feed(data.data(), data.size()); }
+
+        //Дали прочетеното досега се разпознава
+        bool isAccepting() const;
+
+        //Дали няма активни състояния. Тогава никое продължение не може да бъде разпознато
+        bool isDead() const;
+
+        //Разпознава цялата дума отначало
+        bool accepts(const std::string& input);
+
+    private:
+        std::shared_ptr<const CompiledAutomaton> automaton;
+        uint32_t state; //Текущото състояние за детерминирани автомати
+        SparseSet current;
+        SparseSet next;
+        std::vector<uint32_t> stack;
+    };
+
+    size_t getStateCount() const { return finals.size(); }
+
+    //Брой класове на символите, включително клас 0 - символите без преходи
+    size_t getClassCount() const { return classCount; }
+
+    //Индекс на началното състояние или NO_STATE, ако няма такова
+    uint32_t getStartState() const { return startState; }
+
+    bool isFinal(uint32_t state) const { return finals[state] != 0; }
+
+    //Дали автоматът няма празни преходи и от всяко състояние има най-много един преход с всеки клас
+    bool isDeterministic() const { return deterministic; }
+
+    //Дали преходите на детерминирания автомат са в компресираната таблица
+    bool usesCombTable() const { return !combBase.empty(); }
+
+    uint16_t getClass(unsigned char symbol) const { return classOf[symbol]; }
+
+    //Следващото състояние на детерминиран автомат или NO_STATE, ако няма преход или от следващото не се достига финално.
+    //За недетерминирани автомати не се използва
+    uint32_t next(uint32_t state, unsigned char symbol) const {
+        if (!combBase.empty()) {
+            size_t slot = combBase[state] + classOf[symbol];
+            return combCheck[slot] == state ? combNext[slot] : NO_STATE;
+        }
+        if (!narrowTable.empty()) {
+            uint16_t target = narrowTable[state * classCount + classOf[symbol]];
+            return target == NO_NARROW_STATE ? NO_STATE : target;
+        }
+        return table[state * classCount + classOf[symbol]];
+    }
+
+    //Връща интервалите от символи, които образуват класа
+    std::vector<SymbolRange> getClassRanges(uint16_t cls) const;
+
+    //Приблизителен брой байтове, които заема обектът заедно с масивите си
+    size_t memoryUsage() const;
+
+    //Символите от азбуката на оригиналния автомат
+    const std::bitset<256>& getAlphabet() const { return alphabet; }
+
+    //Преходите от състоянието са edge(i) за i в [edgeBegin(state), edgeEnd(state))
+    size_t edgeBegin(uint32_t state) const { return edgeOffsets[state]; }
+    size_t edgeEnd(uint32_t state) const { return edgeOffsets[state + 1]; }
+    uint16_t edgeClass(size_t edge) const { return edgeClasses[edge]; }
+    uint32_t edgeTarget(size_t edge) const { return edgeTargets[edge]; }
+
+    //Празните преходи от състоянието са epsilonTarget(i) за i в [epsilonBegin(state), epsilonEnd(state))
+    size_t epsilonBegin(uint32_t state) const { return epsilonOffsets[state]; }
+    size_t epsilonEnd(uint32_t state) const { return epsilonOffsets[state + 1]; }
+    uint32_t epsilonTarget(size_t edge) const { return epsilonTargets[edge]; }
+
+    /*Записва автомата в компактния формат: заглавие "FAUT", версия и флагове, последвани от блокове (по желание компресирани).
+    Индексите са varint, а преходите на всяко състояние - разлики спрямо предишния клас и спрямо индекса на състоянието.
+    Ако names не е nullptr, се записват и имената на състоянията*/
+    void save(std::ostream& out, bool compress = true, const std::vector<std::string>* names = nullptr) const;
+
+    void saveToFile(const std::string& fileName, bool compress = true, const std::vector<std::string>* names = nullptr) const;
+
+    //Зарежда автомат, записан със save. Ако names не е nullptr, в него се записват имената (празни, ако не са записани).
+    //При непълен или повреден файл хвърля std::runtime_error
+    static std::unique_ptr<CompiledAutomaton> load(std::istream& in, std::vector<std::string>* names = nullptr);
+
+    static std::unique_ptr<CompiledAutomaton> loadFromFile(const std::string& fileName, std::vector<std::string>* names = nullptr);
+
+    //Връща колко пъти е било активно всяко състояние при разпознаването на думите от corpus (началното също се брои)
+    std::vector<uint64_t> profile(const std::vector<std::string>& corpus) const;
+
+    /*Връща копие със същия език, в което състоянията са преномерирани според visits (например от profile): най-посещаваните
+    са първи, а при равен брой посещения (и за непосещаваните) се запазва редът на BFS от началното състояние. Така редовете
+    на горещите състояния в таблицата на преходите са съседни. Ако newIds не е nullptr, в (*newIds)[стар индекс] се записва новият*/
+    std::shared_ptr<const CompiledAutomaton> renumbered(const std::vector<uint64_t>& visits, std::vector<uint32_t>* newIds = nullptr) const;
+
+private:
+    //Детерминизира част от автомата и симулира останалата със step
+    friend class HybridAutomaton;
+
+    static constexpr uint64_t FORMAT_VERSION = 1;
+    static constexpr uint64_t FLAG_NAMES = 1;
+
+    //Липсващо състояние в тясната таблица на преходите
+    static constexpr uint16_t NO_NARROW_STATE = UINT16_MAX;
+
+    //Паралелното разпознаване симулира всички състояния във всяка част, затова се използва само за малки автомати
+    //и за части от поне PARALLEL_MIN_CHUNK символа
+    static constexpr size_t PARALLEL_MAX_STATES = 1024;
+    static constexpr size_t PARALLEL_MIN_CHUNK = size_t(1) << 16;
+
+    //Компресираната таблица се използва, ако плътната е поне толкова байта и компресираната е поне COMB_MIN_RATIO пъти по-малка.
+    //Малките таблици се побират в кеша и без компресия, а проверката check струва едно четене повече на символ
+    static constexpr size_t COMB_MIN_DENSE_BYTES = size_t(1) << 16;
+    static constexpr size_t COMB_MIN_RATIO = 2;
+
+    //Колко отмествания най-много се пробват за един ред, преди да се постави след края на масивите. Без ограничението
+    //гъстите редове обхождат всички дупки и разполагането е квадратично спрямо броя на състоянията
+    static constexpr size_t COMB_MAX_PROBES = 256;
+
+    CompiledAutomaton() : classCount(1), startState(NO_STATE), deterministic(true) {}
+
+    std::array<uint16_t, 256> classOf;
+    size_t classCount;
+    std::bitset<256> alphabet;
+    uint32_t startState;
+    std::vector<uint8_t> finals;
+
+    std::vector<uint32_t> edgeOffsets;
+    std::vector<uint16_t> edgeClasses;
+    std::vector<uint32_t> edgeTargets;
+
+    std::vector<uint32_t> epsilonOffsets;
+    std::vector<uint32_t> epsilonTargets;
+
+    bool deterministic;
+
+    //Плътна таблица на преходите за детерминирани автомати: table[state * classCount + class]. Попълва се само едната от двете
+    std::vector<uint32_t> table;
+    std::vector<uint16_t> narrowTable;
+
+    //Компресирана таблица (row displacement): редът на състоянието започва от combBase[state], а преходът с клас cls е
+    //combNext[combBase[state] + cls], ако combCheck на същата позиция е state. Иначе няма преход
+    std::vector<uint32_t> combBase;
+    std::vector<uint32_t> combNext;
+    std::vector<uint32_t> combCheck;
+
+    //Определя дали автоматът е детерминиран и строи таблицата на преходите. Преходите към мъртви състояния се пропускат
+    void buildTable();
+
+    //Минава по таблицата от състоянието state с length символа. Връща NO_STATE, ако някъде няма преход
+    template <typename Target>
+    uint32_t run(const std::vector<Target>& transitions, Target none, uint32_t state, const char* data, size_t length) const;
+
+    //Връща за всяко състояние дали от него се достига финално
+    std::vector<bool> liveStates() const;
+
+    //Строи компресираната таблица от преходите към живите състояния. Връща false и не я запазва, ако не е достатъчно
+    //по-малка от плътната
+    bool buildCombTable(size_t denseBytes, const std::vector<bool>& live);
+
+    //Минава по тази от таблиците, която е попълнена
+    uint32_t runTable(uint32_t state, const char* data, size_t length) const;
+
+    //Записва в mapping[state] състоянието след прочитане на length символа от всяко състояние (NO_STATE, ако няма преход)
+    void runFromAllStates(const char* data, size_t length, std::vector<uint32_t>& mapping) const;
+
+    //Добавя състоянието и достижимите от него с празни преходи в множеството
+    void addWithEpsilonClosure(SparseSet& set, uint32_t state, std::vector<uint32_t>& stack) const;
+
+    //Записва в next състоянията, достижими от current със символ от класа cls, заедно с празните преходи
+    void step(const SparseSet& current, SparseSet& next, std::vector<uint32_t>& stack, uint16_t cls) const;
+
+    bool containsFinal(const SparseSet& set) const;
+};
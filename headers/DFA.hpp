@@ -1,7 +1,8 @@
 ﻿#pragma once
 
 #include "Automaton.hpp"
-#include "PairHash.hpp"
+#include "PairIndex.hpp"
+#include "RegexAST.hpp"
 #include <queue>
 #include <set>
 #include <unordered_map>
@@ -15,22 +16,63 @@ private:
     //Връща състоянието след преход със символ c
     State* getNextState(State* state, char c) const;
 
+    /*Обхожда достижимите двойки (i, j) от състояния на this и other, започвайки от двойката на началните. Липсващ преход води
+    в неявно мъртво състояние с индекс getStateCount() (съответно other.getStateCount()). Двойката от двете мъртви състояния
+    се обхожда само ако combine(false, false) е true и тогава преходите ѝ са с азбуката на двата автомата.
+    onState(index, i, j, isFinal) се извиква за всяка нова двойка, а onTransition(from, low, high, to) - за всеки преход.
+    Ако onState върне false, обхождането спира. Връща false, ако е спряно*/
+    template <typename OnState, typename OnTransition>
+    bool exploreProduct(const DFA& other, const std::function<bool(bool, bool)>& combine, OnState onState, OnTransition onTransition) const;
+
 public:
     //Добавя преход в автомата
     void addTransition(State* source, char c, State* destination);
 
+    //Добавя преход с всички символи от интервала [low, high]. Не се добавя, ако някой от символите вече има преход от source
+    void addRangeTransition(State* source, unsigned char low, unsigned char high, State* destination);
+
     //Връща true, ако автоматът разпознава думата, false, ако не
     bool accepts(const std::string& input) const override;
 
-    //Връща указател към автомат, който разпознава сечението на езиците на this и other. 
-    DFA* intersectWith(const DFA& other) const;
+    /*Строи произведението на this и other. combine получава дали думата е в езика на this и дали е в езика на other и връща
+    дали е в резултата. Частичните автомати се допълват с неявно мъртво състояние, а двойките се номерират плътно (i * |other| + j),
+    ако таблицата е достатъчно малка, иначе с хеш таблица*/
+    DFA product(const DFA& other, const std::function<bool(bool, bool)>& combine) const;
+
+    //Проверява дали езикът на произведението е празен, без да го строи. Спира при първата достижима финална двойка
+    bool isProductEmpty(const DFA& other, const std::function<bool(bool, bool)>& combine) const;
+
+    //Връща автомат, който разпознава обединението на езиците на this и other
+    DFA unionWith(const DFA& other) const;
+
+    //Връща автомат, който разпознава сечението на езиците на this и other
+    DFA intersectWith(const DFA& other) const;
+
+    //Връща автомат, който разпознава думите от езика на this, които не са в езика на other
+    DFA differenceWith(const DFA& other) const;
+
+    //Връща автомат, който разпознава думите, които са в точно един от езиците на this и other
+    DFA symmetricDifferenceWith(const DFA& other) const;
+
+    //Проверява дали всяка дума от езика на this е в езика на other
+    bool isSubsetOf(const DFA& other) const;
+
+    //Проверява дали this и other разпознават един и същи език
+    bool isEquivalentTo(const DFA& other) const;
+
+    //Връща автомат, който разпознава допълнението на езика на this спрямо азбуката му. Липсващите преходи водят в ново мъртво състояние,
+    //което става финално. Състоянията, от които след допълнението не се достига финално, се премахват (виж trim).
+    //Ако this е временен обект, допълнението се прави в неговите състояния
+    DFA complement() const&;
+    DFA complement() &&;
 
-    //Връща указател към автомат, който разпознава допълнението на езика на this
-    DFA* complement() const;
+    //Връща автомат с минимален брой състояния, който разпознава езикът на this
+    DFA minimize()const;
 
-    //Връща указател към автомат с минимален брой състояния, който разпознава езикът на this
-    DFA* minimize()const;
+    //Минимизация на Бжозовски: обръщане и детерминизация два пъти. Удобна е за автомати, получени от обърнат детерминиран автомат
+    DFA minimizeBrzozowski()const;
 
-    //Преобразува автомата в регулярен израз
+    //Преобразува автомата в регулярен израз чрез премахване на състояния. Състоянията се премахват в ред, започващ от тези с най-малко
+    //входящи * изходящи преходи, а изразите се пазят в споделено дърво и се превръщат в низ само веднъж накрая
     std::string toRegex()const;
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "DFA.hpp"
+
+/*Строи минимален ацикличен детерминиран автомат за краен списък от думи (алгоритъм на Daciuk, Mihov, Watson и Watson).
+Думите се добавят в лексикографски ред. След всяка дума частта от предишната, която вече не може да се промени, се минимизира веднага:
+всяко нейно състояние се заменя с еквивалентно от регистъра или се добавя в него. Така междинният автомат е минимален
+без последната добавена дума и паметта е ограничена от размера на минималния автомат плюс дължината на една дума*/
+class DictionaryBuilder
+{
+public:
+    DictionaryBuilder();
+
+    //Регистърът сочи към nodes на този обект, затова builder-ът не се копира
+    DictionaryBuilder(const DictionaryBuilder&) = delete;
+    DictionaryBuilder& operator=(const DictionaryBuilder&) = delete;
+
+    //Добавя дума. Думите трябва да идват в нарастващ лексикографски ред (по unsigned char). Повторенията се пропускат.
+    //При дума, по-малка от предишната, хвърля std::invalid_argument
+    void add(const std::string& word);
+
+    //Минимизира останалата част и връща автомата. След това builder-ът е празен и може да се използва отново
+    DFA build();
+
+    //Строи автомат от думи в произволен ред, като първо ги подрежда
+    static DFA fromWords(std::vector<std::string> words);
+
+private:
+    struct Node
+    {
+        bool isFinal;
+        std::vector<std::pair<unsigned char, uint32_t>> edges; //Подредени по символ
+    };
+
+    //Хеш и сравнение на възел по финалност и преходи. Регистърът пази индекси, а съдържанието се чете от nodes
+    struct NodeHash
+    {
+        const std::vector<Node>* nodes;
+        size_t operator()(uint32_t node) const;
+    };
+    struct NodeEqual
+    {
+        const std::vector<Node>* nodes;
+        bool operator()(uint32_t left, uint32_t right) const;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes; //Освободени индекси в nodes за преизползване
+    std::unordered_set<uint32_t, NodeHash, NodeEqual> registry;
+
+    //Пътят на последната дума от корена (path[0] е коренът). Възлите по него още не са в регистъра
+    std::vector<uint32_t> path;
+    std::string previous;
+    bool hasPrevious;
+
+    uint32_t newNode();
+
+    //Минимизира възлите от пътя след първите keep + 1 и ги маха от пътя
+    void replaceOrRegister(size_t keep);
+};
@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Automaton.hpp"
+#include "CompiledAutomaton.hpp"
+#include "SparseSet.hpp"
+
+/*Детерминизация с ограничен брой състояния. Конструкцията на подмножествата върви в ширина от началното състояние, докато
+не се получат maxStates състояния или детерминираната част не достигне maxBytes байта. Преходите към подмножества, които не са
+построени, водят към симулация на недетерминирания автомат от текущото подмножество, а симулацията се връща в детерминираната част,
+щом стигне до построено подмножество. Така често използваната част близо до началото е детерминиран автомат, а паметта е ограничена
+независимо от шаблона. Обектът не се променя след създаването си и може да се използва от много нишки*/
+class HybridAutomaton
+{
+public:
+    //Строи детерминираната част с най-много maxStates състояния (поне 1) и най-много maxBytes байта за таблицата,
+    //подмножествата и индекса им (началното състояние се строи винаги). Паметта се отчита в MemoryLimit
+    HybridAutomaton(const Automaton& automaton, size_t maxStates, size_t maxBytes = SIZE_MAX);
+
+    //Дали всички достижими подмножества са построени, т.е. симулацията никога не е нужна
+    bool isComplete() const { return complete; }
+
+    //Брой състояния на детерминираната част
+    size_t getStateCount() const { return finals.size(); }
+
+    //Байтовете на детерминираната част (таблица, подмножества и индекс), без недетерминирания автомат
+    size_t memoryUsage() const;
+
+    //Разпознаване с Matcher, създаден за извикването
+    bool accepts(const std::string& input) const;
+
+    //Потоково разпознаване. Паметта се заделя при създаването, затова feed не заделя памет. По време на симулация на всеки
+    //SWITCH_CHECK_INTERVAL символа се проверява дали текущото множество е построено състояние и ако е, разпознаването продължава
+    //с таблицата. Един Matcher се използва от една нишка. Matcher без автомат е мъртъв и не разпознава нищо
+    class Matcher
+    {
+    public:
+        explicit Matcher(std::shared_ptr<const HybridAutomaton> automaton);
+
+        //Връща се в началното състояние
+        void reset();
+
+        //Обработва следващата част от входа
+        void feed(const char* data, size_t length);
+        void feed(const std::string& data) { feed(data.data(), data.size()); }
+
+        //Дали прочетеното досега се разпознава
+        bool isAccepting() const;
+
+        //Дали никое продължение не може да бъде разпознато
+        bool isDead() const;
+
+        //Разпознава цялата дума отначало
+        bool accepts(const std::string& input);
+
+    private:
+        std::shared_ptr<const HybridAutomaton> automaton;
+        uint32_t state; //Текущото състояние на детерминираната част
+        bool simulating; //Дали се симулира недетерминираният автомат
+        size_t sinceCheck; //Символи от последната проверка за връщане в детерминираната част
+        SparseSet current;
+        SparseSet next;
+        std::vector<uint32_t> stack;
+    };
+
+private:
+    static constexpr uint32_t NO_STATE = CompiledAutomaton::NO_STATE;
+
+    //Преход към подмножество, което не е построено заради ограничението
+    static constexpr uint32_t NOT_BUILT = NO_STATE - 1;
+
+    //През колко символа симулацията търси текущото множество сред построените. Търсенето е O(размера на множеството),
+    //колкото една стъпка на симулацията
+    static constexpr size_t SWITCH_CHECK_INTERVAL = 8;
+
+    std::shared_ptr<const CompiledAutomaton> nfa;
+    bool complete;
+    uint32_t startState;
+    std::vector<uint8_t> finals;
+
+    //table[state * classCount + class] е следващото състояние, NO_STATE или NOT_BUILT
+    std::vector<uint32_t> table;
+
+    //Подмножеството от състояния на nfa за всяко състояние: subsetStates[subsetOffsets[state]..subsetOffsets[state + 1])
+    std::vector<uint32_t> subsetOffsets;
+    std::vector<uint32_t> subsetStates;
+
+    //Хешът на всяко подмножество и хеш таблица с отворено адресиране от хеша към състоянието (NO_STATE за празните места).
+    //Служи и за индекс при строенето, и за връщане от симулацията, затова подмножествата не се пазят втори път
+    std::vector<uint64_t> subsetHashes;
+    std::vector<uint32_t> subsetLookup;
+
+    //Хеш на множество, който не зависи от реда на елементите
+    static uint64_t hashSubset(const SparseSet& set);
+
+    //Построеното състояние с подмножество set (с хеш hash) или NO_STATE
+    uint32_t findSubset(const SparseSet& set, uint64_t hash) const;
+
+    //Добавя последното построено състояние в subsetLookup, като я удвоява, ако е наполовина пълна
+    void indexLastSubset();
+};
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstddef>
+#include <stdexcept>
+
+//Хвърля се, когато конструкция би надхвърлила ограничението на MemoryLimit. Частично построеният резултат се освобождава,
+//а входните автомати не се променят, затова програмата може да продължи
+class MemoryLimitExceeded : public std::runtime_error
+{
+public:
+    MemoryLimitExceeded(size_t limit, size_t requested);
+
+    size_t getLimit() const { return limit; }
+
+    //Колко байта биха били използвани, ако заделянето беше позволено
+    size_t getRequested() const { return requested; }
+
+private:
+    size_t limit;
+    size_t requested;
+};
+
+/*Ограничение на паметта, която конструкциите на автомати заделят в текущата нишка, докато обектът съществува. Отчитат се
+преди заделянето: новите състояния и преходи (по същата оценка като Automaton::memoryUsage), множествата и индексът
+им при детерминизацията, индексът на двойките при произведенията, разделянето при DFA::minimize, масивите и таблиците
+на CompiledAutomaton (freeze, load, renumbered, Searcher), състоянията на HybridAutomaton и таблиците на BitParallelNFA.
+Временните масиви и контейнерите се оценяват по размера на съдържанието им, а не по точния разход на заделящия механизъм.
+Освободената памет не се връща в бюджета, затова ограничението е горна граница за всичко, построено в обхвата.
+Ограниченията могат да се влагат и тогава се спазват всички. Без активно ограничение проверката е едно сравнение с nullptr*/
+class MemoryLimit
+{
+public:
+    explicit MemoryLimit(size_t bytes);
+    ~MemoryLimit();
+
+    MemoryLimit(const MemoryLimit&) = delete;
+    MemoryLimit& operator=(const MemoryLimit&) = delete;
+
+    //Колко байта са отчетени досега
+    size_t getUsed() const { return used; }
+
+    size_t getLimit() const { return limit; }
+
+    //Отчита bytes в активните ограничения на нишката. Хвърля MemoryLimitExceeded, без да отчита нищо, ако някое би било надхвърлено
+    static void charge(size_t bytes)
+    {
+        if (current)
+        {
+            current->add(bytes);
+        }
+    }
+
+    //Колко байта още могат да бъдат отчетени в текущата нишка (SIZE_MAX без активно ограничение). Използва се за избор
+    //между плътно и по-икономично представяне
+    static size_t available();
+
+private:
+    size_t limit;
+    size_t used;
+    MemoryLimit* outer;
+
+    static thread_local MemoryLimit* current;
+
+    void add(size_t bytes);
+};
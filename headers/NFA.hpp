@@ -2,11 +2,14 @@
 
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
-#include <stack>
 #include <string>
+#include <memory>
 #include "Automaton.hpp"
-#include "PairHash.hpp"
+#include "DFA.hpp"
+#include "PairIndex.hpp"
+#include "SparseSet.hpp"
+
+class BitParallelNFA;
 
 class NFA : public Automaton
 {
@@ -17,25 +20,54 @@ public:
     //Добавя преход в автомата
     void addTransition(State* source, char symbol, State* destination);
 
-    //Връща true, ако автоматът разпознава думата, false, ако не
+    //Добавя преход с всички символи от интервала [low, high]
+    void addRangeTransition(State* source, unsigned char low, unsigned char high, State* destination);
+
+    //Връща true, ако автоматът разпознава думата, false, ако не. За автомати с най-много BitParallelNFA::MAX_STATES състояния
+    //при първото извикване се строи BitParallelNFA и се пази до следващата промяна на автомата. Ако той не може да се построи,
+    //не се побира в MemoryLimit или автоматът е по-голям, се симулира множеството от текущи състояния
     bool accepts(const std::string& input) const override;
     
-    //Връща указател към автомат, който разпознава обединението на езиците на this и other
-    NFA* unionWith(const NFA& other) const;
+    /*Операциите връщат нов автомат по стойност. Ако this е временен обект (например резултат от друга операция или std::move),
+    резултатът се строи направо в неговите състояния, а състоянията на other се преместват, без да се копират.
+    Така a.unionWith(b).kleeneStar().determinize() не копира целия граф на всяка стъпка*/
+
+    //Връща автомат, който разпознава обединението на езиците на this и other
+    NFA unionWith(const NFA& other) const&;
+    NFA unionWith(NFA&& other) &&;
+
+    //Връща автомат, който разпознава конкатенацията на езиците на this и other
+    NFA concatWith(const NFA& other) const&;
+    NFA concatWith(NFA&& other) &&;
 
-    //Връща указател към автомат, който разпознава конкатенацията на езиците на this и other
-    NFA* concatWith(const NFA& other) const;
+    //Връща автомат, който разпознава сечението на езиците на this и other
+    NFA intersectWith(const NFA& other) const;
 
-    //Връща указател към автомат, който разпознава сечението на езиците на this и other
-    NFA* intersectWith(const NFA& other) const;
+    //Връща автомат, който се получава след прилагането на звездата на Клини върху този автомат
+    NFA kleeneStar() const&;
+    NFA kleeneStar() &&;
 
-    ////Връща указател към автомат, който се получава след прилагането на звездата на Клини върху този автомат
-    NFA* kleeneStar() const;
+    //Връща детерминиран автомат със същия език (конструкция на подмножествата). Участват само полезните състояния,
+    //а преходите се строят по интервалите от getSymbolClasses, а не по отделни символи
+    DFA determinize() const;
+
+protected:
+    //Автоматът не се променя едновременно с разпознаване, затова кешът се изчиства без синхронизация
+    void onChange() override { bitParallel.reset(); }
+
+    size_t cacheMemoryUsage() const override;
 
 private:
-    //Връща множество от указатели към достижимите с празни преходи състояния от подадено множество от указатели към състояния в автомата
-    std::unordered_set<State*> epsilonClosure(const std::unordered_set<State*>& states) const;
+    //Резултатът от BitParallelNFA::fromNFA. engine е nullptr, ако автоматът не отговаря на изискванията на побитовата симулация
+    struct BitParallelCache
+    {
+        std::shared_ptr<const BitParallelNFA> engine;
+    };
+
+    //Строи се при първото разпознаване. Достъпът е чрез std::atomic_load и std::atomic_store, защото accepts може да се извиква
+    //от много нишки. Копията на автомата споделят кеша, тъй като имат същите преходи
+    mutable std::shared_ptr<const BitParallelCache> bitParallel;
 
-    //Връща множество от указатели към достижимите с подаден символ състояния от подадено множество от указатели към състояния, включително и състоянията, достижими чрез празни преходи
-    std::unordered_set<State*> getNextStatesWithEpsilon(const std::unordered_set<State*>& currentStates, char symbol) const;
+    //Добавя състоянието и достижимите от него с празни преходи състояния в множеството. stack е работна памет, заделена от извикващия
+    void addWithEpsilonClosure(SparseSet& set, State* state, std::vector<State*>& stack) const;
 };
\ No newline at end of file
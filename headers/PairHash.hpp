@@ -1,10 +1,18 @@
 ﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <utility>
 
-struct PairHash { //Персонализирана хешираща функция функция за stateMap, когато ключът е std::pair<State*, State*>
+struct PairHash { //Персонализирана хешираща функция функция за stateMap, когато ключът е std::pair
     template <typename T1, typename T2>
     std::size_t operator()(const std::pair<T1, T2>& p) const {
-        auto hash1 = std::hash<T1>()(p.first);
-        auto hash2 = std::hash<T2>()(p.second);
-        return hash1 ^ (hash2 << 1);
+        //Двата хеша се смесват с умножение и разбъркване на битовете. С hash1 ^ (hash2 << 1) двойките (a, b) и (b, a),
+        //както и много двойки от малки числа, попадаха в една и съща клетка
+        uint64_t x = static_cast<uint64_t>(std::hash<T1>()(p.first)) * 0x9E3779B97F4A7C15ull;
+        x ^= static_cast<uint64_t>(std::hash<T2>()(p.second)) + 0x632BE59BD9B4E019ull + (x << 6) + (x >> 2);
+        x ^= x >> 31;
+        x *= 0xD6E8FEB86659FD93ull;
+        x ^= x >> 32;
+        return static_cast<std::size_t>(x);
     }
 };
\ No newline at end of file
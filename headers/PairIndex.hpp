@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MemoryLimit.hpp"
+#include "PairHash.hpp"
+
+//Номерира двойки (i, j) с i < rows и j < columns в реда на добавяне. Използва се за състоянията на произведение на автомати.
+//Ако rows * columns е до DENSE_LIMIT и плътният масив се побира в MemoryLimit, номерата се пазят в него с индекс i * columns + j,
+//иначе - в хеш таблица. Паметта се отчита в MemoryLimit: плътният масив наведнъж, а хеш таблицата - при всяко добавяне
+class PairIndex
+{
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+    static constexpr size_t DENSE_LIMIT = size_t(1) << 22;
+
+    PairIndex(size_t rows, size_t columns) : columns(columns),
+        dense(rows != 0 && columns <= DENSE_LIMIT / rows && rows * columns * sizeof(uint32_t) <= MemoryLimit::available()) {
+        if (dense) {
+            MemoryLimit::charge(rows * columns * sizeof(uint32_t));
+            denseIndex.assign(rows * columns, UINT32_MAX);
+        }
+    }
+
+    //Връща номера на двойката или NONE, ако не е добавена
+    size_t find(size_t i, size_t j) const {
+        if (dense) {
+            uint32_t index = denseIndex[i * columns + j];
+            return index == UINT32_MAX ? NONE : index;
+        }
+        auto found = sparseIndex.find({ i, j });
+        return found == sparseIndex.end() ? NONE : found->second;
+    }
+
+    //Добавя двойката, ако я няма. Връща номера ѝ и дали е нова
+    std::pair<size_t, bool> insert(size_t i, size_t j) {
+        size_t index = pairs.size();
+        if (dense) {
+            uint32_t& slot = denseIndex[i * columns + j];
+            if (slot != UINT32_MAX) {
+                return { slot, false };
+            }
+            MemoryLimit::charge(sizeof(pairs[0]));
+            slot = static_cast<uint32_t>(index);
+        }
+        else {
+            auto found = sparseIndex.find({ i, j });
+            if (found != sparseIndex.end()) {
+                return { found->second, false };
+            }
+            MemoryLimit::charge(sizeof(pairs[0]) + SPARSE_ENTRY_BYTES);
+            sparseIndex.emplace(std::make_pair(i, j), index);
+        }
+        pairs.push_back({ i, j });
+        return { index, true };
+    }
+
+    size_t size() const { return pairs.size(); }
+
+    //Двойката с даден номер
+    const std::pair<size_t, size_t>& operator[](size_t index) const { return pairs[index]; }
+
+private:
+    //Възел на хеш таблицата с двойката, номера и указателя към следващия, и едно място в масива на кофите
+    static constexpr size_t SPARSE_ENTRY_BYTES = sizeof(std::pair<const std::pair<size_t, size_t>, size_t>) + 2 * sizeof(void*);
+
+    size_t columns;
+    bool dense;
+    std::vector<uint32_t> denseIndex;
+    std::unordered_map<std::pair<size_t, size_t>, size_t, PairHash> sparseIndex;
+    std::vector<std::pair<size_t, size_t>> pairs;
+};
@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Споделено (hash-consed) синтактично дърво на регулярен израз.
+//Всеки възел се пази веднъж в масив и се реферира чрез индекс, затова еднаквите подизрази не се копират.
+//Конструкторите опростяват израза още при създаването на възела, а низът се генерира само веднъж - в toString
+class RegexAST
+{
+public:
+    using NodeId = size_t;
+
+    enum class NodeType { EmptySet, Epsilon, Symbol, Union, Concat, Star };
+
+    struct Node {
+        NodeType type;
+        unsigned char low; //Интервалът от символи [low, high] за NodeType::Symbol
+        unsigned char high;
+        std::vector<NodeId> children;
+        bool nullable; //Дали езикът на възела съдържа празната дума
+    };
+
+    //Създава дърво, съдържащо само възлите за празното множество и празната дума
+    RegexAST();
+
+    //Връща възела за празното множество
+    NodeId emptySet() const { return EMPTY_SET; }
+
+    //Връща възела за празната дума
+    NodeId epsilon() const { return EPSILON; }
+
+    //Връща възела за един символ
+    NodeId symbol(char c);
+
+    //Връща възела за клас от символи [low, high]
+    NodeId symbol(unsigned char low, unsigned char high);
+
+    //Връща възела за обединението на a и b
+    NodeId unite(NodeId a, NodeId b);
+
+    //Връща възела за конкатенацията на a и b
+    NodeId concat(NodeId a, NodeId b);
+
+    //Връща възела за звездата на Клини върху a
+    NodeId star(NodeId a);
+
+    //Връща възела с даден индекс
+    const Node& getNode(NodeId id) const { return nodes[id]; }
+
+    //Връща броя на различните възли в дървото
+    size_t getNodeCount() const { return nodes.size(); }
+
+    //Преобразува израза с корен root в низ със синтаксиса на RegexToNFA (+ обединение, . конкатенация, * звезда, @ празна дума,
+    //[a-z] клас от символи, ? произволен видим символ)
+    //Празното множество се представя с празен низ
+    std::string toString(NodeId root) const;
+
+private:
+    static constexpr NodeId EMPTY_SET = 0;
+    static constexpr NodeId EPSILON = 1;
+
+    struct NodeHash {
+        size_t operator()(const Node& node) const;
+    };
+
+    struct NodeEqual {
+        bool operator()(const Node& a, const Node& b) const;
+    };
+
+    //Масив от всички възли. Индексът в масива е идентификаторът на възела
+    std::vector<Node> nodes;
+
+    //Таблица, по която се намират вече създадени възли
+    std::unordered_map<Node, NodeId, NodeHash, NodeEqual> index;
+
+    //Добавя възела, ако още не съществува, и връща индекса му
+    NodeId intern(Node node);
+
+    //Добавя децата на възела към списъка, като разгръща вложените възли от същия тип
+    void flatten(NodeType type, NodeId id, std::vector<NodeId>& children) const;
+
+    //Връща приоритета на възела при извеждане
+    int priority(NodeId id) const;
+
+    //Добавя низовото представяне на възела към result
+    void write(NodeId id, std::string& result) const;
+};
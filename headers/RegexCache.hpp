@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "CompiledAutomaton.hpp"
+
+/*Кеш на компилирани регулярни изрази с ограничение в байтове и изхвърляне на най-отдавна използвания (LRU).
+Записите са неизменими CompiledAutomaton, които се споделят чрез shared_ptr, затова изхвърлен запис остава жив, докато някой го ползва.
+Едновременните заявки за един и същ израз чакат една обща компилация. Може да се използва от много нишки*/
+class RegexCache
+{
+public:
+    using Compiler = std::function<std::shared_ptr<const CompiledAutomaton>(const std::string&)>;
+
+    struct Statistics
+    {
+        uint64_t hits;      //Заявки, обслужени от кеша, включително изчакалите чужда компилация
+        uint64_t misses;    //Компилации
+        uint64_t evictions; //Изхвърлени записи
+        size_t entries;
+        size_t bytes;
+    };
+
+    //byteBudget е максималната сума от CompiledAutomaton::memoryUsage на записите. Без compiler изразът се превръща в минимален
+    //детерминиран автомат: RegexToNFA::fromRegex, determinize, minimize и freeze
+    explicit RegexCache(size_t byteBudget, Compiler compiler = nullptr);
+
+    RegexCache(const RegexCache&) = delete;
+    RegexCache& operator=(const RegexCache&) = delete;
+
+    //Връща компилирания израз. Грешките при компилация (например std::invalid_argument) се предават на всички чакащи,
+    //а изразът не остава в кеша
+    std::shared_ptr<const CompiledAutomaton> get(const std::string& regex);
+
+    Statistics getStatistics() const;
+
+    //Премахва всички готови записи
+    void clear();
+
+    //Компилаторът по подразбиране
+    static std::shared_ptr<const CompiledAutomaton> compileMinimal(const std::string& regex);
+
+private:
+    struct Entry
+    {
+        std::string regex;
+        std::shared_future<std::shared_ptr<const CompiledAutomaton>> automaton;
+        size_t bytes;
+        bool ready; //Докато компилацията не е завършила, записът не се брои и не се изхвърля
+    };
+
+    size_t byteBudget;
+    Compiler compiler;
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; //Най-скоро използваният е пръв
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    //Изхвърля готови записи от края, докато сумата надвишава ограничението. Извиква се със заключен mutex
+    void evict();
+};
@@ -0,0 +1,58 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "CompiledAutomaton.hpp"
+#include "RegexCache.hpp"
+
+/*Кеш на компилирани регулярни изрази на диска. Името на файла е хеш на израза, на настройките на компилатора и на версията на кеша,
+затова промяна в някое от тях води до нов файл, а не до остарял резултат. Файлът съдържа заглавие с израза и настройките,
+64-битов FNV-1a хеш на останалата част и автомата във формата на CompiledAutomaton::save. При зареждане заглавието и хешът
+се проверяват преди автомата да бъде прочетен и при несъответствие или повреда изразът се компилира наново и файлът се презаписва.
+Записват се само преходите, затова зареждането строи таблицата на преходите наново (CompiledAutomaton::load, включително
+компресираната таблица) - по-бързо от компилацията на израза, но не е само четене. Файловете се записват във временен файл
+и се преименуват, затова няколко процеса или нишки могат да използват една директория.
+Може да се използва като компилатор на RegexCache, за да се пазят резултатите и в паметта*/
+class RegexDiskCache
+{
+public:
+    struct Statistics
+    {
+        uint64_t loads;        //Изрази, заредени от диска
+        uint64_t compilations; //Изрази, компилирани наново
+        uint64_t rejected;     //Файлове, които са повредени (включително с грешен хеш) или са за друг израз
+    };
+
+    //directory трябва да съществува. options описва настройките на compiler и участва в хеша. Без compiler се използва
+    //RegexCache::compileMinimal
+    explicit RegexDiskCache(std::string directory, std::string options = "", RegexCache::Compiler compiler = nullptr);
+
+    RegexDiskCache(const RegexDiskCache&) = delete;
+    RegexDiskCache& operator=(const RegexDiskCache&) = delete;
+
+    //Зарежда израза от диска или го компилира и записва. Ако записът не успее, връща компилирания автомат
+    std::shared_ptr<const CompiledAutomaton> get(const std::string& regex);
+
+    //Пътят на файла за израза
+    std::string pathFor(const std::string& regex) const;
+
+    Statistics getStatistics() const { return { loads.load(), compilations.load(), rejected.load() }; }
+
+private:
+    //Увеличава се, когато се промени компилаторът по подразбиране или форматът на файла
+    static constexpr uint64_t CACHE_VERSION = 2;
+
+    std::string directory;
+    std::string options;
+    RegexCache::Compiler compiler;
+    std::atomic<uint64_t> loads;
+    std::atomic<uint64_t> compilations;
+    std::atomic<uint64_t> rejected;
+    std::atomic<uint64_t> temporaryCounter;
+
+    //Зарежда файла, ако е за този израз и е цял. Иначе връща nullptr
+    std::shared_ptr<const CompiledAutomaton> tryLoad(const std::string& path, const std::string& regex);
+
+    void store(const std::string& path, const std::string& regex, const CompiledAutomaton& automaton);
+};
@@ -1,18 +1,32 @@
 ﻿#pragma once
 #include <iostream>
+#include <stdexcept>
 
 #include <stack>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include "NFA.hpp"
 
 class RegexToNFA
 {
 public:
-    //Връща УКАЗАТЕЛ към недетерминиран автомат, построен от регулярен израз
-    static NFA* fromRegex(const std::string& regex);
+    //Връща недетерминиран автомат, построен от регулярен израз. Междинните автомати се преместват, а не се копират
+    static NFA fromRegex(const std::string& regex);
+
+    //Връща автомата на Глушков (позиционния автомат) за регулярния израз. Той няма празни преходи и има точно
+    //(брой символи в израза + 1) състояния: начално и по едно за всяка позиция. Затова е подходящ за побитова симулация.
+    //Операторът за сечение '&' не се поддържа
+    static NFA fromRegexGlushkov(const std::string& regex);
 
 private:
+    //Свойствата на подизраз, от които се строи автоматът на Глушков
+    struct GlushkovSets {
+        bool nullable; //Дали подизразът разпознава празната дума
+        std::vector<size_t> first; //Позициите, с които може да започне дума
+        std::vector<size_t> last; //Позициите, с които може да завърши дума
+    };
+
     //Връща дали символът е оператор
     static bool isOperator(char c);
 
@@ -23,8 +37,17 @@ private:
     static std::string toPostfix(const std::string& regex);
 
     //Обработва символ, който не е оператор
-    static NFA* handleChar(char c);
+    static NFA handleChar(char c);
+
+    //Обработва клас от символи, например [a-z0-9_]. Всеки интервал от класа е едно ребро
+    static NFA handleClass(const std::string& body);
+
+    //Разбира съдържанието на клас от символи в списък от интервали
+    static std::vector<SymbolRange> parseClass(const std::string& body);
+
+    //Обработва символ, който е оператор. Операндите се вземат от стека
+    static NFA handleOperator(char op, std::stack<NFA>& stack);
 
-    //Обработва символ, който е оператор
-    static NFA* handleOperator(char op, std::stack<NFA*>& stack);
+    //Премахва и връща автомата на върха на стека. Ако стекът е празен, изразът е невалиден
+    static NFA popOperand(std::stack<NFA>& stack);
 };
\ No newline at end of file
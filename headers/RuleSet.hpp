@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledAutomaton.hpp"
+#include "RegexCache.hpp"
+
+/*Набор от правила (регулярни изрази), които се проверяват заедно и се добавят и премахват по няколко наведнъж.
+Правилата са разделени на групи от най-много shardSize правила. Над групите има двоично дърво: всеки възел пази автомат
+за обединението на езиците под него, а коренът - за целия набор. Обединенията се строят от вече компилираните автомати
+(на правилата в група и на двете деца във възел), без изразите да се превеждат наново. При промяна се отбелязват групата
+на правилото и пътят от нея до корена. Следващата проверка строи наново само отбелязаните групи, затова цената на промяната
+зависи от размера на групата, а не от размера на набора. Отбелязаните вътрешни възли се строят само в rebuild, а дотогава
+проверката слиза в децата им. Обединение, което не се побира в mergeBudget байта (по оценката на MemoryLimit), не се строи
+и проверката също слиза в децата на възела. Така след rebuild при обединим набор accepts чете входа веднъж с автомата
+на корена, независимо от броя на групите.
+За всяко правило се пази и отделен автомат, с който се определя кои правила от съвпаднала група разпознават входа.
+Проверките могат да строят автомати, затова обектът не бива да се използва от няколко нишки едновременно*/
+class RuleSet
+{
+public:
+    static constexpr size_t DEFAULT_SHARD_SIZE = 32;
+    static constexpr size_t DEFAULT_MERGE_BUDGET = size_t(16) << 20;
+
+    //Без compiler правилата се компилират с RegexCache::compileMinimal
+    explicit RuleSet(size_t shardSize = DEFAULT_SHARD_SIZE, RegexCache::Compiler compiler = nullptr, size_t mergeBudget = DEFAULT_MERGE_BUDGET);
+
+    //Добавя правило и връща номера му. Изразът се компилира веднага, затова грешен израз хвърля изключение и не се добавя
+    uint32_t add(const std::string& regex);
+
+    //Премахва правилото. Връща false, ако няма правило с този номер
+    bool remove(uint32_t rule);
+
+    //Дали някое правило разпознава думата
+    bool accepts(const std::string& input);
+
+    //Връща номерата на правилата, които разпознават думата, във възходящ ред. Слиза само във възлите, чиито автомати разпознават думата
+    std::vector<uint32_t> matches(const std::string& input);
+
+    //Строи автоматите на всички отбелязани възли, включително обединенията до корена. Цената е до едно обединение на целия набор
+    void rebuild();
+
+    size_t size() const { return shardOf.size(); }
+
+    //Броят на непразните групи
+    size_t getShardCount() const;
+
+    //Броят на групите, чиито автомати ще се строят при следващата проверка
+    size_t getStaleShardCount() const;
+
+    //Колко автомата чете accepts при текущото дърво: 1, ако коренът е обединен, и повече, ако някои обединения са твърде големи
+    //или не са построени наново след промяна
+    size_t getCoverSize();
+
+private:
+    struct Rule
+    {
+        uint32_t id;
+        std::shared_ptr<const CompiledAutomaton> automaton;
+    };
+
+    struct Shard
+    {
+        std::vector<Rule> rules;
+    };
+
+    //Възел от дървото на обединенията. tree[0][i] е за групата i, а tree[level][i] - за tree[level - 1][2i] и tree[level - 1][2i + 1]
+    struct Node
+    {
+        std::shared_ptr<const CompiledAutomaton> automaton; //nullptr, ако под възела няма правила или обединението не е построено
+        bool merged = true; //false, ако обединението надхвърля mergeBudget и проверката слиза в децата
+        bool stale = true;
+    };
+
+    size_t shardSize;
+    RegexCache::Compiler compiler;
+    size_t mergeBudget;
+    std::vector<Shard> shards;
+    std::vector<std::vector<Node>> tree;
+    std::vector<size_t> openShards; //Групите с по-малко от shardSize правила
+    std::unordered_map<uint32_t, size_t> shardOf;
+    uint32_t nextId;
+    bool changed; //Дали има отбелязани групи, за да не се обхожда дървото при всяка проверка
+
+    //Отбелязва групата и пътя от нея до корена
+    void markStale(size_t shard);
+
+    //Добавя празна група и разширява дървото
+    size_t addShard();
+
+    //Строи отбелязаните групи (tree[0]). Вътрешните възли остават отбелязани до rebuild
+    void refresh();
+
+    //Строи автомата на възела от автоматите на правилата (на ниво 0) или на децата му
+    void build(size_t level, size_t index);
+
+    //Обединението на езиците на автоматите или nullptr, ако не се побира в mergeBudget
+    std::shared_ptr<const CompiledAutomaton> unionOf(const std::vector<const CompiledAutomaton*>& parts) const;
+
+    bool acceptsBelow(size_t level, size_t index, const std::string& input) const;
+    void matchesBelow(size_t level, size_t index, const std::string& input, std::vector<uint32_t>& result) const;
+    size_t coverBelow(size_t level, size_t index) const;
+};
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Automaton.hpp"
+#include "CompiledAutomaton.hpp"
+
+/*Търсене на думи от езика на автомат в текст. Използват се два компилирани детерминирани автомата: прав за езика Σ*L, който
+намира най-ранния край на съвпадение, и обратен за обърнатия език на L, който от този край се връща назад до най-лявото начало.
+Така всяко търсене чете всеки символ най-много по веднъж във всяка посока. Обектът не се променя след създаването си
+и може да се използва от много нишки едновременно*/
+class Searcher
+{
+public:
+    //Съвпадение в текста: символите в [begin, end)
+    struct Match
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    //Строи двата автомата. Правият се получава чрез детерминизация на Σ*L и може да е значително по-голям от automaton
+    explicit Searcher(const Automaton& automaton);
+
+    //Търси съвпадението с най-ранен край, което започва не по-рано от from. Сред съвпаденията с този край избира това
+    //с най-лявото начало. Връща false, ако няма съвпадение
+    bool find(const std::string& text, Match& match, size_t from = 0) const { return find(text.data(), text.size(), match, from); }
+    bool find(const char* text, size_t length, Match& match, size_t from = 0) const;
+
+    //Дали в текста има съвпадение. Чете само с правия автомат и спира при първия край на съвпадение
+    bool contains(const char* text, size_t length) const;
+
+    //Връща съвпаденията, които не се застъпват, от ляво надясно. След празно съвпадение търсенето продължава от следващия символ
+    std::vector<Match> findAll(const std::string& text) const;
+
+private:
+    std::shared_ptr<const CompiledAutomaton> forward;
+    std::shared_ptr<const CompiledAutomaton> backward;
+
+    //Намира с правия автомат най-ранния край на съвпадение, започващо не по-рано от from
+    bool findEnd(const char* text, size_t length, size_t from, size_t& end) const;
+};
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include "CompiledAutomaton.hpp"
+
+/*Споделен текущ автомат, който може да се заменя, докато други нишки разпознават с него (по схемата read-copy-update).
+Четящите нишки вземат снимка с load() и работят с нея без заключване - тя е неизменима и остава жива, докато някой я държи.
+Новият автомат се строи отделно (например с Automaton::freeze) и се публикува с атомарно store(). Започнатите разпознавания
+завършват със стария автомат, следващите load() виждат новия, а старият се освобождава от последния, който го пусне*/
+class SharedAutomaton
+{
+public:
+    explicit SharedAutomaton(std::shared_ptr<const CompiledAutomaton> automaton = nullptr) : current(std::move(automaton)) {}
+
+    SharedAutomaton(const SharedAutomaton&) = delete;
+    SharedAutomaton& operator=(const SharedAutomaton&) = delete;
+
+    //Връща текущия автомат. Снимката не се променя от последващи замени
+    std::shared_ptr<const CompiledAutomaton> load() const {
+        return std::atomic_load_explicit(&current, std::memory_order_acquire);
+    }
+
+    //Публикува нов автомат за всички следващи load()
+    void store(std::shared_ptr<const CompiledAutomaton> automaton) {
+        std::atomic_store_explicit(&current, std::move(automaton), std::memory_order_release);
+    }
+
+    //Публикува нов автомат и връща предишния
+    std::shared_ptr<const CompiledAutomaton> exchange(std::shared_ptr<const CompiledAutomaton> automaton) {
+        return std::atomic_exchange_explicit(&current, std::move(automaton), std::memory_order_acq_rel);
+    }
+
+    //Разпознава думата с текущия автомат. Ако няма автомат, връща false
+    bool accepts(const std::string& input) const {
+        std::shared_ptr<const CompiledAutomaton> automaton = load();
+        return automaton && automaton->accepts(input);
+    }
+
+private:
+    std::shared_ptr<const CompiledAutomaton> current;
+};
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <vector>
+#include <cstddef>
+
+//Множество от цели числа в [0, capacity) по Briggs и Torczon. Добавяне, проверка и изчистване са O(1) и не заделят памет след конструирането.
+//Елементите се обхождат в реда на добавяне, затова симулацията е детерминирана
+class SparseSet
+{
+public:
+    explicit SparseSet(size_t capacity) : dense(capacity), sparse(capacity), count(0) {}
+
+    //Проверява дали числото е в множеството
+    bool contains(size_t value) const {
+        size_t index = sparse[value];
+        return index < count && dense[index] == value;
+    }
+
+    //Добавя числото, ако още не е в множеството. Връща true, ако е добавено
+    bool insert(size_t value) {
+        if (contains(value)) {
+            return false;
+        }
+        dense[count] = value;
+        sparse[value] = count++;
+        return true;
+    }
+
+    //Изчиства множеството, без да освобождава памет
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    size_t capacity() const { return dense.size(); }
+
+    //Елементите в реда на добавянето им
+    const size_t* begin() const { return dense.data(); }
+    const size_t* end() const { return dense.data() + count; }
+
+private:
+    //dense[0..count) са елементите, а sparse[x] е позицията на x в dense
+    std::vector<size_t> dense;
+    std::vector<size_t> sparse;
+    size_t count;
+};
@@ -3,20 +3,46 @@
 #include <unordered_map>
 #include <vector>
 
+struct State;
+
+//Интервал от символи [low, high]
+using SymbolRange = std::pair<unsigned char, unsigned char>;
+
+//Преходи с всички символи от интервала [low, high] към състоянията в destinations
+struct TransitionRange {
+    unsigned char low;
+    unsigned char high;
+    std::vector<State*> destinations;
+};
+
 struct State {
-    std::string name;
+    //Индекс на състоянието в масива на автомата, към който принадлежи. Алгоритмите работят с него вместо с указатели.
+    //Имената се пазят отделно в автомата (виж Automaton::getStateName)
+    size_t id;
     bool isFinal;
 
-    /*Поддържа се възможността за множество преходи с един и същ символ специално за епсилон преходите на недетерминираните автомати
-    Предприети са мерки да може да се добави преход най-много с един символ за детерминирани автомати*/
-    std::unordered_map<char, std::vector<State*>> transitions;
+    /*Преходите са подредени по символ, непресичащи се интервали. Всеки интервал пази състоянията, към които води, затова
+    един клас от символи е едно ребро, а не по едно ребро за всеки символ. Поддържа се възможността за множество състояния в един интервал
+    за недетерминираните автомати. Предприети са мерки да може да се добави най-много едно за детерминирани автомати*/
+    std::vector<TransitionRange> transitions;
 
-    //Ако състоянието е финално, вторият параметър се слага true. За нефинални е false или може да се пропусне
-    State(const std::string& name, bool isFinal = false) : name(name), isFinal(isFinal) {}
+    //Преходите с празния символ '@'
+    std::vector<State*> epsilonTransitions;
 
+    //Ако състоянието е финално, параметърът се слага true. За нефинални е false или може да се пропусне
+    State(bool isFinal = false) : id(0), isFinal(isFinal) {}
+
+    //Добавя преход със символ. Символът '@' означава празен преход
     void addTransition(char symbol, State* destination);
 
-    const std::vector<State*> getTransitions(char symbol) const;
+    //Добавя преход с всички символи от интервала [low, high]. Разделя и слива съществуващите интервали, така че да останат непресичащи се
+    void addTransition(unsigned char low, unsigned char high, State* destination);
+
+    //Връща състоянията, достижими с даден символ, без да ги копира. Символът '@' връща празните преходи
+    const std::vector<State*>& getTransitions(char symbol) const;
 
     bool hasTransition(char symbol) const;
-};
\ No newline at end of file
+
+    //Намира интервала, съдържащ символа, чрез двоично търсене. Връща nullptr, ако няма такъв
+    const TransitionRange* findRange(unsigned char symbol) const;
+};
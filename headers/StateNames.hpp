@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*Имената на състоянията на един автомат, отделени от самите състояния. За всяко състояние (по State::id) се пази малък етикет:
+без име, индекс в речника на дадените имена, препратка към състояние на друг автомат или двойка от състояния на два автомата.
+Операциите върху автомати записват само препратки, а низовете се строят едва когато се поискат (print, Graphviz, запис във файл).
+Таблиците на другите автомати се държат чрез shared_ptr и не се променят, затова препратките остават валидни*/
+class StateNames
+{
+public:
+    //Етикетите се задават по индекс на състояние. Състоянията след последния зададен етикет нямат име, затова автомат без имена
+    //не заделя нищо за тях
+
+    //Задава име на състоянието. Еднаквите имена се пазят веднъж
+    void setName(size_t state, const std::string& name);
+
+    //Състоянието носи името на състоянието sourceState от source
+    void setDerived(size_t state, const std::shared_ptr<const StateNames>& source, size_t sourceState);
+
+    //Състоянието съответства на двойката (leftState, rightState). Името му е "ляво_дясно"
+    void setPair(size_t state, const std::shared_ptr<const StateNames>& left, size_t leftState,
+        const std::shared_ptr<const StateNames>& right, size_t rightState);
+
+    //Връща името на състоянието или празен низ, ако то няма име
+    std::string getName(size_t state) const;
+
+    //Дали състоянието има име
+    bool hasName(size_t state) const;
+
+    //Дали на състоянието е зададен етикет, различен от "без име"
+    bool hasLabel(size_t state) const;
+
+    //Запазва само етикетите на състоянията, за които keep е true, като ги подрежда в същия ред
+    void keepOnly(const std::vector<bool>& keep);
+
+    //Приблизителният брой байтове, които таблицата заема. Таблиците на другите автомати, към които сочат препратките, не се броят
+    size_t memoryUsage() const;
+
+private:
+    enum class Kind : uint8_t { Unnamed, Interned, Derived, Pair };
+
+    //За Interned value е индекс в pool. За Derived и Pair value е индекс в sources, а first и second са състояния там
+    struct Label {
+        Kind kind;
+        uint32_t value;
+        uint32_t first;
+        uint32_t second;
+    };
+
+    std::vector<Label> labels;
+    std::vector<std::string> pool;
+    std::unordered_map<std::string, uint32_t> poolIndex;
+    std::vector<std::shared_ptr<const StateNames>> sources;
+    std::unordered_map<const StateNames*, uint32_t> sourceIndex;
+
+    uint32_t intern(const std::string& name);
+
+    //Задава етикета на състоянието, като разширява масива при нужда
+    void setLabel(size_t state, const Label& label);
+
+    //Връща индекса на таблицата в sources, като я добавя, ако я няма
+    uint32_t sourceSlot(const std::shared_ptr<const StateNames>& source);
+
+    //Връща етикет, който сочи към състоянието state от source (то трябва да има етикет). Препратките към препратки се съкращават,
+    //за да не се трупат вериги
+    Label derivedLabel(const std::shared_ptr<const StateNames>& source, size_t state);
+};
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "DFA.hpp"
+#include "NFA.hpp"
+
+/*Генератор на случайни автомати, регулярни изрази и входни думи за измерване на производителността и проверки под натоварване.
+Всичко се определя само от seed: използва се std::mt19937_64, чиято редица е една и съща навсякъде, а числата в интервал
+се получават без std::uniform_int_distribution (чийто резултат зависи от стандартната библиотека). Така един и същ seed дава
+едни и същи данни на всички компилатори. Азбуката е първите alphabetSize малки латински букви*/
+class WorkloadGenerator
+{
+public:
+    static constexpr size_t MAX_ALPHABET_SIZE = 26;
+
+    explicit WorkloadGenerator(uint64_t seed) : random(seed) {}
+
+    //Детерминиран автомат със stateCount състояния, в който всички състояния са достижими от началното. Освен преходите,
+    //нужни за достижимостта, всеки преход (състояние, символ) съществува с вероятност density. Всяко състояние е финално
+    //с вероятност finalRatio
+    DFA randomDFA(size_t stateCount, size_t alphabetSize, double density, double finalRatio = 0.2);
+
+    //Недетерминиран автомат със stateCount състояния, всички достижими от началното. density е средният брой преходи
+    //за (състояние, символ), а epsilonDensity - средният брой празни преходи от състояние
+    NFA randomNFA(size_t stateCount, size_t alphabetSize, double density, double epsilonDensity = 0.0, double finalRatio = 0.2);
+
+    //Случаен регулярен израз с дълбочина на вложеност най-много depth
+    std::string randomRegex(size_t depth, size_t alphabetSize);
+
+    //(a+b)*.a.(a+b)^n: недетерминираният автомат е с O(n) състояния, а минималният детерминиран - с 2^(n+1)
+    static std::string blowupRegex(size_t n);
+
+    //Израз с depth вложени звезди и конкатенации ((a.b)*.a)*.b)*..., с който се проверяват операциите с квадратична сложност
+    static std::string nestedRegex(size_t depth);
+
+    //Случайна дума с дължина length
+    std::string randomText(size_t length, size_t alphabetSize);
+
+    //Случайна дума от езика на автомата с дължина най-много maxLength. Връща false, ако няма такава дума
+    bool acceptedWord(const Automaton& automaton, size_t maxLength, std::string& word);
+
+    //count думи с дължина най-много maxLength. Приблизително дял acceptedRatio от тях са от езика на автомата, а останалите
+    //са случайни думи над азбуката му (и може също да се окажат в езика)
+    std::vector<std::string> corpus(const Automaton& automaton, size_t count, size_t maxLength, double acceptedRatio = 0.5);
+
+private:
+    std::mt19937_64 random;
+
+    //Следващият преход по най-краткия път до финално състояние
+    struct Step
+    {
+        size_t next;
+        unsigned char low;
+        unsigned char high;
+        bool epsilon;
+    };
+
+    //Разстоянията (в символи) до най-близко финално състояние и първите преходи по тези пътища
+    struct WalkTable
+    {
+        std::vector<size_t> distance;
+        std::vector<Step> shortest;
+    };
+
+    static constexpr size_t UNREACHABLE = static_cast<size_t>(-1);
+
+    //Равномерно число в [0, bound)
+    uint64_t below(uint64_t bound);
+
+    //true с вероятност probability
+    bool chance(double probability);
+
+    //Броят на изборите при среден брой average: цялата част и още един с вероятност дробната част
+    size_t count(double average);
+
+    static void checkAlphabetSize(size_t alphabetSize);
+
+    static WalkTable buildWalkTable(const Automaton& automaton);
+
+    bool walk(const Automaton& automaton, const WalkTable& table, size_t maxLength, std::string& word);
+};
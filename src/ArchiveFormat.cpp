@@ -0,0 +1,302 @@
+﻿#include "ArchiveFormat.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+    const size_t MIN_MATCH = 4;
+    const size_t HASH_BITS = 14;
+    const size_t MAX_BLOCK_SIZE = 1 << 24;
+
+    void appendVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    uint64_t parseVarint(const std::string& in, size_t& position)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (position >= in.size())
+            {
+                throw std::runtime_error("Corrupt compressed block.");
+            }
+            uint8_t byte = static_cast<uint8_t>(in[position++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("Corrupt compressed block.");
+    }
+
+    uint32_t hashPrefix(const char* data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+}
+
+std::string BlockCompressor::compress(const std::string& input)
+{
+    std::string output;
+    std::vector<int64_t> lastPosition(size_t(1) << HASH_BITS, -1);
+
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i + MIN_MATCH <= input.size())
+    {
+        uint32_t hash = hashPrefix(input.data() + i);
+        int64_t candidate = lastPosition[hash];
+        lastPosition[hash] = static_cast<int64_t>(i);
+
+        if (candidate < 0 || std::memcmp(input.data() + candidate, input.data() + i, MIN_MATCH) != 0)
+        {
+            i++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (i + length < input.size() && input[candidate + length] == input[i + length])
+        {
+            length++;
+        }
+
+        appendVarint(output, i - literalStart);
+        output.append(input, literalStart, i - literalStart);
+        appendVarint(output, length);
+        appendVarint(output, i - static_cast<size_t>(candidate));
+
+        i += length;
+        literalStart = i;
+    }
+
+    appendVarint(output, input.size() - literalStart);
+    output.append(input, literalStart, std::string::npos);
+    appendVarint(output, 0);
+
+    return output;
+}
+
+std::string BlockCompressor::decompress(const std::string& input, size_t rawLength)
+{
+    std::string output;
+    output.reserve(rawLength);
+
+    size_t position = 0;
+    while (position < input.size())
+    {
+        uint64_t literals = parseVarint(input, position);
+        if (literals > input.size() - position || output.size() + literals > rawLength)
+        {
+            throw std::runtime_error("Corrupt compressed block.");
+        }
+        output.append(input, position, literals);
+        position += literals;
+
+        uint64_t length = parseVarint(input, position);
+        if (length == 0)
+        {
+            break;
+        }
+        uint64_t offset = parseVarint(input, position);
+        if (offset == 0 || offset > output.size() || output.size() + length > rawLength)
+        {
+            throw std::runtime_error("Corrupt compressed block.");
+        }
+
+        //Съвпадението може да се застъпва със самото себе си, затова се копира байт по байт
+        size_t from = output.size() - offset;
+        for (uint64_t k = 0; k < length; k++)
+        {
+            output += output[from + k];
+        }
+    }
+
+    if (output.size() != rawLength || position != input.size())
+    {
+        throw std::runtime_error("Corrupt compressed block.");
+    }
+    return output;
+}
+
+ArchiveWriter::ArchiveWriter(std::ostream& out, bool compress) : out(out), compress(compress)
+{
+    block.reserve(BLOCK_SIZE);
+}
+
+void ArchiveWriter::writeByte(uint8_t value)
+{
+    block += static_cast<char>(value);
+    if (block.size() >= BLOCK_SIZE)
+    {
+        flushBlock();
+    }
+}
+
+void ArchiveWriter::writeBytes(const char* data, size_t length)
+{
+    block.append(data, length);
+    if (block.size() >= BLOCK_SIZE)
+    {
+        flushBlock();
+    }
+}
+
+void ArchiveWriter::writeVarint(uint64_t value)
+{
+    appendVarint(block, value);
+    if (block.size() >= BLOCK_SIZE)
+    {
+        flushBlock();
+    }
+}
+
+void ArchiveWriter::writeSignedVarint(int64_t value)
+{
+    writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void ArchiveWriter::writeRawVarint(std::ostream& out, uint64_t value)
+{
+    std::string bytes;
+    appendVarint(bytes, value);
+    out.write(bytes.data(), bytes.size());
+}
+
+void ArchiveWriter::flushBlock()
+{
+    if (block.empty())
+    {
+        return;
+    }
+
+    //Всеки блок е: дължина без компресия, записана дължина, данни. Ако компресията не помага, блокът се записва както е
+    std::string stored = compress ? BlockCompressor::compress(block) : block;
+    if (stored.size() >= block.size())
+    {
+        stored = block;
+    }
+
+    writeRawVarint(out, block.size());
+    writeRawVarint(out, stored.size());
+    out.write(stored.data(), stored.size());
+    block.clear();
+}
+
+void ArchiveWriter::finish()
+{
+    flushBlock();
+    writeRawVarint(out, 0);
+    out.flush();
+}
+
+ArchiveReader::ArchiveReader(std::istream& in) : in(in), position(0), ended(false)
+{
+}
+
+uint64_t ArchiveReader::readRawVarint(std::istream& in)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = in.get();
+        if (byte == EOF)
+        {
+            throw std::runtime_error("Unexpected end of automaton file.");
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupt automaton file.");
+}
+
+bool ArchiveReader::loadBlock()
+{
+    if (ended)
+    {
+        return false;
+    }
+
+    uint64_t rawLength = readRawVarint(in);
+    if (rawLength == 0)
+    {
+        ended = true;
+        return false;
+    }
+
+    uint64_t storedLength = readRawVarint(in);
+    if (rawLength > MAX_BLOCK_SIZE || storedLength > MAX_BLOCK_SIZE)
+    {
+        throw std::runtime_error("Corrupt automaton file.");
+    }
+
+    std::string stored(storedLength, '\0');
+    if (!in.read(&stored[0], storedLength))
+    {
+        throw std::runtime_error("Unexpected end of automaton file.");
+    }
+
+    block = storedLength == rawLength ? std::move(stored) : BlockCompressor::decompress(stored, rawLength);
+    position = 0;
+    return true;
+}
+
+uint8_t ArchiveReader::readByte()
+{
+    while (position >= block.size())
+    {
+        if (!loadBlock())
+        {
+            throw std::runtime_error("Unexpected end of automaton file.");
+        }
+    }
+    return static_cast<uint8_t>(block[position++]);
+}
+
+void ArchiveReader::readBytes(char* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = static_cast<char>(readByte());
+    }
+}
+
+uint64_t ArchiveReader::readVarint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte = readByte();
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupt automaton file.");
+}
+
+int64_t ArchiveReader::readSignedVarint()
+{
+    uint64_t value = readVarint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void ArchiveReader::expectEnd()
+{
+    if (position != block.size() || loadBlock())
+    {
+        throw std::runtime_error("Corrupt automaton file.");
+    }
+}
@@ -1,30 +1,209 @@
 ﻿#include "Automaton.hpp"
+#include "CompiledAutomaton.hpp"
+#include "MemoryLimit.hpp"
+#include "NFA.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+
+Automaton::Automaton(const Automaton& other) : startState(nullptr)
+{
+    copyFrom(other);
+}
 
+Automaton::Automaton(Automaton&& other) noexcept
+    : states(std::move(other.states)), startState(other.startState), alphabet(std::move(other.alphabet)), names(std::move(other.names))
+{
+    other.states.clear();
+    other.startState = nullptr;
+    other.alphabet.clear();
+}
 
-Automaton::Automaton(const Automaton& other)
+Automaton& Automaton::operator=(const Automaton& other)
 {
+    if (this != &other) {
+        clearStates();
+        setStartState(nullptr);
+        copyFrom(other);
+    }
+    return *this;
+}
 
+Automaton& Automaton::operator=(Automaton&& other) noexcept
+{
+    if (this != &other) {
+        clearStates();
+        states = std::move(other.states);
+        startState = other.startState;
+        alphabet = std::move(other.alphabet);
+        names = std::move(other.names);
+        other.states.clear();
+        other.startState = nullptr;
+        other.alphabet.clear();
+        other.onChange();
+    }
+    return *this;
 }
 
-State* Automaton::addState(const std::string& name, bool isFinal) {
-    State* state = new State(name, isFinal);
+void Automaton::copyFrom(const Automaton& other)
+{
+    alphabet = other.alphabet;
+    names = other.names;
+    states.reserve(other.states.size());
+    for (State* state : other.states) {
+        pushState(state->isFinal);
+    }
+
+    //Индексите на копията съвпадат с тези на оригиналите, затова преходите се пренасочват по индекс
+    for (State* state : other.states) {
+        State* copied = states[state->id];
+        copied->transitions = state->transitions;
+        for (TransitionRange& range : copied->transitions) {
+            for (State*& destination : range.destinations) {
+                destination = states[destination->id];
+            }
+        }
+        copied->epsilonTransitions.reserve(state->epsilonTransitions.size());
+        for (State* next : state->epsilonTransitions) {
+            copied->epsilonTransitions.push_back(states[next->id]);
+        }
+    }
+
+    if (other.startState) {
+        startState = states[other.startState->id];
+    }
+}
+
+void Automaton::absorbStates(Automaton&& other)
+{
+    std::shared_ptr<const StateNames> otherNames = other.sharedNames();
+    for (State* state : other.states) {
+        size_t id = states.size();
+        if (otherNames && otherNames->hasLabel(state->id)) {
+            editNames().setDerived(id, otherNames, state->id);
+        }
+        state->id = id;
+        states.push_back(state);
+    }
+    other.names.reset();
+    alphabet.insert(other.alphabet.begin(), other.alphabet.end());
+
+    other.states.clear();
+    other.startState = nullptr;
+    other.alphabet.clear();
+    other.onChange();
+    onChange();
+}
+
+State* Automaton::pushState(bool isFinal) {
+    MemoryLimit::charge(sizeof(State) + sizeof(State*));
+    State* state = new State(isFinal);
+    state->id = states.size();
     states.push_back(state);
+    onChange();
+
+    return state;
+}
 
+State* Automaton::addState(const std::string& name, bool isFinal) {
+    State* state = pushState(isFinal);
+    if (!name.empty()) {
+        editNames().setName(state->id, name);
+    }
     return state;
 }
 
+State* Automaton::addUnnamedState(bool isFinal) {
+    return pushState(isFinal);
+}
+
+State* Automaton::addDerivedState(const Automaton& source, const State* state, bool isFinal) {
+    State* added = pushState(isFinal);
+    if (source.names && source.names->hasLabel(state->id)) {
+        editNames().setDerived(added->id, source.names, state->id);
+    }
+    return added;
+}
+
+State* Automaton::addPairState(const Automaton& leftSource, const State* left, const Automaton& rightSource, const State* right, bool isFinal) {
+    State* added = pushState(isFinal);
+    if (leftSource.names || rightSource.names) {
+        editNames().setPair(added->id, leftSource.names, left->id, rightSource.names, right->id);
+    }
+    return added;
+}
+
+StateNames& Automaton::editNames() {
+    if (!names) {
+        names = std::make_shared<StateNames>();
+    }
+    else if (names.use_count() > 1) {
+        names = std::make_shared<StateNames>(*names);
+    }
+    return *names;
+}
+
+std::shared_ptr<const StateNames> Automaton::sharedNames() const {
+    return names;
+}
+
+std::string Automaton::getStateName(const State* state) const {
+    if (names && names->hasName(state->id)) {
+        return names->getName(state->id);
+    }
+    return "q" + std::to_string(state->id);
+}
+
+void Automaton::setStateName(State* state, const std::string& name) {
+    editNames().setName(state->id, name);
+}
+
 size_t Automaton::getStateCount() const
 {
     return states.size();
 }
 
+Automaton::MemoryUsage Automaton::memoryUsage() const
+{
+    MemoryUsage usage{ sizeof(*this) + states.capacity() * sizeof(State*), 0, 0, 0, cacheMemoryUsage() };
+    for (const State* state : states)
+    {
+        usage.states += sizeof(State);
+        usage.edges += state->transitions.capacity() * sizeof(TransitionRange) + state->epsilonTransitions.capacity() * sizeof(State*);
+        for (const TransitionRange& range : state->transitions)
+        {
+            usage.edges += range.destinations.capacity() * sizeof(State*);
+        }
+    }
+    if (names)
+    {
+        usage.names = names->memoryUsage();
+    }
+
+    //Всеки символ е отделен възел със следващ указател, а масивът с кофите е с по един указател
+    usage.alphabet = alphabet.size() * (sizeof(void*) + sizeof(char)) + alphabet.bucket_count() * sizeof(void*);
+    return usage;
+}
+
 void Automaton::clearStates() {
-    for (State* state : getStates())
+    for (State* state : states)
     {
         delete state;
     }
 
     states.clear();
+    names.reset();
+    onChange();
 }
 
 void Automaton::clearAlphabet() {
@@ -35,7 +214,209 @@ void Automaton::addSymbolToAlphabet(char c) {
     alphabet.insert(c);
 }
 
-std::vector<State*> Automaton::getNextStates(State* state, char symbol) const {
+void Automaton::addRangeToAlphabet(unsigned char low, unsigned char high) {
+    for (int c = low; c <= high; c++) {
+        alphabet.insert(static_cast<char>(c));
+    }
+}
+
+std::vector<SymbolRange> Automaton::getSymbolClasses(const Automaton* other) const
+{
+    //boundary[c] е true, ако някой интервал започва от c или свършва точно преди c. delta се използва, за да знаем дали символите са в някой преход
+    std::vector<int> delta(257, 0);
+    std::vector<bool> boundary(257, false);
+
+    auto collect = [&delta, &boundary](const Automaton& automaton) {
+        for (State* state : automaton.states) {
+            for (const TransitionRange& range : state->transitions) {
+                delta[range.low]++;
+                delta[range.high + 1]--;
+                boundary[range.low] = true;
+                boundary[range.high + 1] = true;
+            }
+        }
+    };
+
+    collect(*this);
+    if (other) {
+        collect(*other);
+    }
+
+    std::vector<SymbolRange> classes;
+    int coverage = 0;
+    int start = 0;
+    for (int c = 0; c <= 256; c++) {
+        if (c == 256 || boundary[c]) {
+            if (c > start && coverage > 0) {
+                classes.push_back({ static_cast<unsigned char>(start), static_cast<unsigned char>(c - 1) });
+            }
+            start = c;
+        }
+        if (c < 256) {
+            coverage += delta[c];
+        }
+    }
+
+    return classes;
+}
+
+std::vector<bool> Automaton::getUsefulStates() const
+{
+    const size_t n = states.size();
+    std::vector<bool> reachable(n, false);
+    std::vector<bool> coreachable(n, false);
+
+    if (!startState) {
+        return reachable;
+    }
+
+    //Права BFS от началното състояние
+    std::vector<size_t> queue;
+    queue.reserve(n);
+    queue.push_back(startState->id);
+    reachable[startState->id] = true;
+
+    auto visit = [&queue](std::vector<bool>& visited, size_t id) {
+        if (!visited[id]) {
+            visited[id] = true;
+            queue.push_back(id);
+        }
+    };
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        const State* state = states[queue[i]];
+        for (const TransitionRange& range : state->transitions) {
+            for (const State* next : range.destinations) {
+                visit(reachable, next->id);
+            }
+        }
+        for (const State* next : state->epsilonTransitions) {
+            visit(reachable, next->id);
+        }
+    }
+
+    //Обърнатите ребра се пазят в два масива: predecessors[offsets[i]..offsets[i + 1]) са предшествениците на i
+    std::vector<size_t> offsets(n + 1, 0);
+    auto forEachEdge = [this](auto&& func) {
+        for (const State* state : states) {
+            for (const TransitionRange& range : state->transitions) {
+                for (const State* next : range.destinations) {
+                    func(state->id, next->id);
+                }
+            }
+            for (const State* next : state->epsilonTransitions) {
+                func(state->id, next->id);
+            }
+        }
+    };
+    forEachEdge([&offsets](size_t, size_t to) { offsets[to + 1]++; });
+    for (size_t i = 0; i < n; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    std::vector<size_t> predecessors(offsets[n]);
+    std::vector<size_t> position(offsets.begin(), offsets.end() - 1);
+    forEachEdge([&predecessors, &position](size_t from, size_t to) { predecessors[position[to]++] = from; });
+
+    //Обратна BFS от финалните състояния
+    queue.clear();
+    for (const State* state : states) {
+        if (state->isFinal) {
+            visit(coreachable, state->id);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); i++) {
+        size_t id = queue[i];
+        for (size_t j = offsets[id]; j < offsets[id + 1]; j++) {
+            visit(coreachable, predecessors[j]);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        reachable[i] = reachable[i] && coreachable[i];
+    }
+    return reachable;
+}
+
+size_t Automaton::trim()
+{
+    if (!startState) {
+        return 0;
+    }
+
+    std::vector<bool> useful = getUsefulStates();
+    bool emptyLanguage = !useful[startState->id];
+    useful[startState->id] = true; //Началното състояние остава, дори езикът да е празен
+
+    //При празен език началното състояние остава без преходи, за да спира разпознаването веднага и при примки към него
+    if (emptyLanguage) {
+        startState->transitions.clear();
+        startState->epsilonTransitions.clear();
+    }
+
+    std::vector<State*> kept;
+    kept.reserve(states.size());
+    for (State* state : states) {
+        if (useful[state->id]) {
+            kept.push_back(state);
+        }
+    }
+    size_t removed = states.size() - kept.size();
+    if (removed == 0) {
+        if (emptyLanguage) {
+            onChange();
+        }
+        return 0;
+    }
+
+    //Махаме преходите към премахнатите състояния, преди да ги изтрием
+    auto isRemoved = [&useful](const State* state) { return !useful[state->id]; };
+    for (State* state : kept) {
+        std::vector<TransitionRange> ranges;
+        ranges.reserve(state->transitions.size());
+        for (TransitionRange& range : state->transitions) {
+            range.destinations.erase(std::remove_if(range.destinations.begin(), range.destinations.end(), isRemoved), range.destinations.end());
+            if (range.destinations.empty()) {
+                continue;
+            }
+            if (!ranges.empty() && ranges.back().high + 1 == range.low && ranges.back().destinations == range.destinations) {
+                ranges.back().high = range.high;
+            }
+            else {
+                ranges.push_back(std::move(range));
+            }
+        }
+        state->transitions = std::move(ranges);
+        state->epsilonTransitions.erase(std::remove_if(state->epsilonTransitions.begin(), state->epsilonTransitions.end(), isRemoved),
+            state->epsilonTransitions.end());
+    }
+
+    for (State* state : states) {
+        if (!useful[state->id]) {
+            delete state;
+        }
+    }
+
+    if (names) {
+        editNames().keepOnly(useful);
+    }
+    states = std::move(kept);
+    for (size_t i = 0; i < states.size(); i++) {
+        states[i]->id = i;
+    }
+    onChange();
+
+    return removed;
+}
+
+std::string Automaton::rangeToString(unsigned char low, unsigned char high)
+{
+    if (low == high) {
+        return std::string(1, static_cast<char>(low));
+    }
+    return std::string("[") + static_cast<char>(low) + "-" + static_cast<char>(high) + "]";
+}
+
+const std::vector<State*>& Automaton::getNextStates(State* state, char symbol) const {
     return state->getTransitions(symbol);
 }
 
@@ -48,7 +429,7 @@ void Automaton::print() const {
     for (State* state : states) {
         bool hasTransitions = false;
 
-        std::cout << "State: " << state->name;
+        std::cout << "State: " << getStateName(state);
 
         if (state == startState) {
             std::cout << " (Start)";
@@ -59,27 +440,18 @@ void Automaton::print() const {
 
         std::cout << std::endl << "Transitions: " << std::endl;
 
-        int maxLength = 0;
-
-        for (const char& c : alphabet) {
-            std::vector<State*> nextStates = getNextStates(state, c);
-            if (!nextStates.empty()) {
-                hasTransitions = true;
-                for (State* next : nextStates) {
-                    std::cout << state->name << "--" << c << "-->" << next->name << std::endl;
-                }
+        for (const TransitionRange& range : state->transitions) {
+            hasTransitions = true;
+            for (State* next : range.destinations) {
+                std::cout << getStateName(state) << "--" << rangeToString(range.low, range.high) << "-->" << getStateName(next) << std::endl;
             }
         }
 
-        std::vector<State*> epsilonTransitions = getNextStates(state, '@');
-        if (!epsilonTransitions.empty()) {
+        for (State* next : state->epsilonTransitions) {
             hasTransitions = true;
-            for (State* next : epsilonTransitions) {
-                std::cout << state->name << "--@-->" << next->name << std::endl;
-            }
+            std::cout << getStateName(state) << "--@-->" << getStateName(next) << std::endl;
         }
 
-
         if (!hasTransitions) {
             std::cout << "None" << std::endl;
         }
@@ -90,7 +462,7 @@ void Automaton::print() const {
 
 void Automaton::copyStates(const Automaton& source, Automaton& target, std::unordered_map<State*, State*>& stateMap, std::function<void(State*, State*)> func)const {
     for (State* state : source.getStates()) {
-        State* copied = target.addState(state->name, state->isFinal);
+        State* copied = target.addDerivedState(source, state, state->isFinal);
         stateMap[state] = copied;
 
         func(state, copied); //Позполява преизползването на метода за различни алгоритми
@@ -101,192 +473,424 @@ void Automaton::copyTransitions(const Automaton& source, Automaton& target, std:
 {
     for (State* state : source.getStates())
     {
-        for (char c : source.getAlphabet())
+        State* copied = stateMap[state];
+
+        //Интервалите вече са подредени и непресичащи се, затова ги копираме директно и само заменяме състоянията
+        if (copied->transitions.empty())
         {
-            for (State* next : state->getTransitions(c))
+            copied->transitions = state->transitions;
+            for (TransitionRange& range : copied->transitions)
             {
-                target.addTransition(stateMap[state], c, stateMap[next]);
+                for (State*& next : range.destinations)
+                {
+                    next = stateMap[next];
+                }
+            }
+        }
+        else
+        {
+            for (const TransitionRange& range : state->transitions)
+            {
+                for (State* next : range.destinations)
+                {
+                    target.addRangeTransition(copied, range.low, range.high, stateMap[next]);
+                }
             }
         }
-        for (State* next : state->getTransitions('@'))
+
+        for (State* next : state->epsilonTransitions)
         {
-            target.addTransition(stateMap[state], '@', stateMap[next]);
+            target.addTransition(copied, '@', stateMap[next]);
         }
     }
+
+    target.alphabet.insert(source.alphabet.begin(), source.alphabet.end());
 }
-void Automaton::saveToFile(const std::string& fileName)const
+
+NFA Automaton::reverse()const
 {
-    std::ofstream file(fileName, std::ios::out | std::ios::binary);
+    NFA result;
+    if (!startState) {
+        return result;
+    }
 
-    if (!file.is_open())
-    {
-        throw std::invalid_argument("Could not open file for writing.");
+    std::vector<State*> finals;
+    for (State* state : states) {
+        State* copied = result.addDerivedState(*this, state, state == startState);
+        if (state->isFinal) {
+            finals.push_back(copied);
+        }
     }
 
-    size_t alphabetSize = getAlphabet().size();
-    file.write(reinterpret_cast<const char*>(&alphabetSize), sizeof(alphabetSize));
-    for (char c : getAlphabet())
-    {
-        file.write(reinterpret_cast<const char*>(&c), sizeof(c));
+    const std::vector<State*>& reversed = result.getStates();
+    for (State* state : states) {
+        for (const TransitionRange& range : state->transitions) {
+            for (State* next : range.destinations) {
+                reversed[next->id]->addTransition(range.low, range.high, reversed[state->id]);
+            }
+        }
+        for (State* next : state->epsilonTransitions) {
+            reversed[next->id]->epsilonTransitions.push_back(reversed[state->id]);
+        }
     }
+    result.alphabet = alphabet;
 
-    size_t stateCount = getStateCount();
-    file.write(reinterpret_cast<const char*>(&stateCount), sizeof(stateCount));
+    //С едно финално състояние не е нужно ново начално
+    if (finals.size() == 1) {
+        result.setStartState(finals[0]);
+    }
+    else {
+        State* start = result.addUnnamedState();
+        for (State* finalState : finals) {
+            start->epsilonTransitions.push_back(finalState);
+        }
+        result.setStartState(start);
+    }
 
-    std::unordered_map<State*, size_t> stateIndexMap;
-    size_t index = 0;
-    for (State* state : getStates())
+    return result;
+}
+
+std::shared_ptr<const CompiledAutomaton> Automaton::freeze()const
+{
+    return std::make_shared<const CompiledAutomaton>(*this);
+}
+
+void Automaton::saveToFile(const std::string& fileName, bool compress)const
+{
+    std::vector<std::string> stateNames;
+    stateNames.reserve(states.size());
+    for (State* state : states)
     {
-        stateIndexMap[state] = index++;
+        stateNames.push_back(names && names->hasName(state->id) ? names->getName(state->id) : std::string());
+    }
+
+    CompiledAutomaton(*this).saveToFile(fileName, compress, &stateNames);
+}
 
-        file.write(reinterpret_cast<const char*>(&state->name), sizeof(state->name));
+void Automaton::loadFromFile(const std::string& fileName)
+{
+    std::vector<std::string> stateNames;
+    std::unique_ptr<CompiledAutomaton> compiled = CompiledAutomaton::loadFromFile(fileName, &stateNames);
 
-        bool isFinal = state->isFinal;
-        file.write(reinterpret_cast<const char*>(&isFinal), sizeof(isFinal));
+    clearStates();
+    clearAlphabet();
+    setStartState(nullptr);
+
+    const uint32_t stateCount = static_cast<uint32_t>(compiled->getStateCount());
+    for (uint32_t i = 0; i < stateCount; i++)
+    {
+        if (stateNames[i].empty())
+        {
+            addUnnamedState(compiled->isFinal(i));
+        }
+        else
+        {
+            addState(stateNames[i], compiled->isFinal(i));
+        }
     }
 
-    State* start = getStartState();
-    size_t startIndex = stateIndexMap[start];
-    file.write(reinterpret_cast<const char*>(&startIndex), sizeof(startIndex));
+    if (compiled->getStartState() != CompiledAutomaton::NO_STATE)
+    {
+        setStartState(states[compiled->getStartState()]);
+    }
 
-    for (State* state : getStates())
+    std::vector<std::vector<SymbolRange>> classRanges(compiled->getClassCount());
+    for (size_t cls = 1; cls < compiled->getClassCount(); cls++)
     {
-        size_t stateIdx = stateIndexMap[state];
+        classRanges[cls] = compiled->getClassRanges(static_cast<uint16_t>(cls));
+    }
 
-        for (char c : alphabet)
+    for (uint32_t i = 0; i < stateCount; i++)
+    {
+        for (size_t edge = compiled->edgeBegin(i); edge < compiled->edgeEnd(i); edge++)
         {
-            std::vector<State*> nextStates = state->getTransitions(c);
-            for (State* nextState : nextStates)
+            for (const SymbolRange& range : classRanges[compiled->edgeClass(edge)])
             {
-                size_t nextStateIdx = stateIndexMap[nextState];
-                file.write(reinterpret_cast<const char*>(&stateIdx), sizeof(stateIdx));
-                file.write(reinterpret_cast<const char*>(&c), sizeof(c));
-                file.write(reinterpret_cast<const char*>(&nextStateIdx), sizeof(nextStateIdx));
+                addRangeTransition(states[i], range.first, range.second, states[compiled->edgeTarget(edge)]);
             }
-
         }
-
-        char epsilon = '@';
-
-        if(state->hasTransition(epsilon))
-        for (State* nextState : state->getTransitions(epsilon)) {
-            size_t nextStateIdx = stateIndexMap[nextState];
-            file.write(reinterpret_cast<const char*>(&stateIdx), sizeof(stateIdx));
-            file.write(reinterpret_cast<const char*>(&epsilon), sizeof(char));
-            file.write(reinterpret_cast<const char*>(&nextStateIdx), sizeof(nextStateIdx));
+        for (size_t edge = compiled->epsilonBegin(i); edge < compiled->epsilonEnd(i); edge++)
+        {
+            addTransition(states[i], '@', states[compiled->epsilonTarget(edge)]);
         }
-
     }
 
-    file.close();
+    //Преходите добавят символите си в азбуката, затова тя се възстановява точно след тях
+    clearAlphabet();
+    for (int c = 0; c < 256; c++)
+    {
+        if (compiled->getAlphabet().test(c))
+        {
+            addSymbolToAlphabet(static_cast<char>(c));
+        }
+    }
 }
 
-void Automaton::loadFromFile(const std::string& fileName)
+void Automaton::vizualize() const
 {
-    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    saveAsPng("output");
+
+    //Отваря изображението с програмата по подразбиране, без да чака
+#if defined(_WIN32)
+    runProgram({ "explorer", "output.png" }, false);
+#elif defined(__APPLE__)
+    runProgram({ "open", "output.png" }, false);
+#else
+    runProgram({ "xdg-open", "output.png" }, false);
+#endif
+}
 
-    if (!file.is_open())
+void Automaton::saveAsPng(const std::string& fileName) const
+{
+    exportGraphviz(fileName + ".dot");
+    if (!runProgram({ "dot", "-Tpng", fileName + ".dot", "-o", fileName + ".png" }, true))
     {
-        throw std::invalid_argument("Could not open file for reading.");
+        throw std::runtime_error("Could not run Graphviz.");
     }
+}
 
-    clearStates();
-    clearAlphabet();
-    setStartState(nullptr);
-
-    size_t alphabetSize;
-    file.read(reinterpret_cast<char*>(&alphabetSize), sizeof(alphabetSize));
-    for (size_t i = 0; i < alphabetSize; ++i)
+bool Automaton::runProgram(const std::vector<std::string>& arguments, bool wait)
+{
+    //Програмата се стартира директно, без командния интерпретатор, затова имената на файлове не се тълкуват
+    std::vector<char*> argv;
+    for (const std::string& argument : arguments)
     {
-        char c;
-        file.read(reinterpret_cast<char*>(&c), sizeof(c));
-        addSymbolToAlphabet(c);
+        argv.push_back(const_cast<char*>(argument.c_str()));
     }
-
-    size_t stateCount;
-    file.read(reinterpret_cast<char*>(&stateCount), sizeof(stateCount));
-
-    std::vector<State*> stateIndexMap(stateCount);
-
-    for (size_t i = 0; i < stateCount; ++i)
+    argv.push_back(nullptr);
+
+#ifdef _WIN32
+    intptr_t result = _spawnvp(wait ? _P_WAIT : _P_NOWAIT, argv[0], argv.data());
+    return result != -1 && (!wait || result == 0);
+#else
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
     {
-        std::string name;
-        file.read(reinterpret_cast<char*>(&name), sizeof(name));
-
-        bool isFinal;
-        file.read(reinterpret_cast<char*>(&isFinal), sizeof(isFinal));
-
-        State* state = addState(name, isFinal);
-        stateIndexMap[i] = state;
+        return false;
     }
-
-    size_t startIndex;
-    file.read(reinterpret_cast<char*>(&startIndex), sizeof(startIndex));
-    setStartState(stateIndexMap[startIndex]);
-
-    while (!file.eof())
+    if (!wait)
     {
-        size_t sourceIndex, destinationIndex;
-        char c;
+        return true;
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) == -1)
+    {
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+}
 
-        file.read(reinterpret_cast<char*>(&sourceIndex), sizeof(sourceIndex));
-        file.read(reinterpret_cast<char*>(&c), sizeof(c));
-        file.read(reinterpret_cast<char*>(&destinationIndex), sizeof(destinationIndex));
+void Automaton::exportGraphviz(const std::string& fileName, size_t maxStates) const
+{
+    std::ofstream file(fileName, std::ios::out | std::ios::binary);
 
-        State* source = stateIndexMap[sourceIndex];
-        State* destination = stateIndexMap[destinationIndex];
-        addTransition(source, c, destination);
+    if (!file.is_open())
+    {
+        throw std::invalid_argument("Could not open file for writing.");
     }
 
-    file.close();
+    exportGraphviz(file, maxStates);
 }
 
-void Automaton::vizualize() const
+void Automaton::exportGraphviz(std::ostream& out, size_t maxStates) const
 {
-    generateGraphvizFile("output.dot");
-    system("dot -Tpng .\\GeneratedAutomatons\\output.dot -o .\\GeneratedAutomatons\\output.png");
-    system("start .\\GeneratedAutomatons\\output.png");
+    writeGraphviz([&out](const char* data, size_t length) { out.write(data, length); }, maxStates);
+    out.flush();
 }
 
-void Automaton::saveAsPng(const std::string& fileName) const
+void Automaton::exportGraphviz(int fileDescriptor, size_t maxStates) const
 {
-    generateGraphvizFile(fileName + ".dot");
-    system(("dot -Tpng .\\GeneratedAutomatons\\" + fileName + ".dot -o .\\GeneratedAutomatons\\" + fileName + ".png").c_str());
+    writeGraphviz([fileDescriptor](const char* data, size_t length)
+        {
+            while (length > 0)
+            {
+#ifdef _WIN32
+                int written = _write(fileDescriptor, data, static_cast<unsigned int>(length));
+#else
+                ssize_t written = write(fileDescriptor, data, length);
+#endif
+                if (written <= 0)
+                {
+                    throw std::runtime_error("Could not write to file descriptor.");
+                }
+                data += written;
+                length -= static_cast<size_t>(written);
+            }
+        }, maxStates);
 }
 
-//Създава dot файл за автомата по синтаксиса на Graphviz
-void Automaton::generateGraphvizFile(const std::string& fileName)const {
-    std::ofstream file("GeneratedAutomatons\\" + fileName);
+//Създава описание на автомата по синтаксиса на Graphviz. Редовете се събират в буфер и се записват на големи блокове
+void Automaton::writeGraphviz(const std::function<void(const char*, size_t)>& write, size_t maxStates) const
+{
+    const size_t BUFFER_SIZE = 1 << 20;
+    std::string buffer;
+    buffer.reserve(BUFFER_SIZE + 4096);
 
-    if (!file.is_open()) {
-        std::cerr << "Could not open file for writing." << std::endl;
-        return;
-    }
+    auto flushIfFull = [&buffer, &write, BUFFER_SIZE]()
+    {
+        if (buffer.size() >= BUFFER_SIZE)
+        {
+            write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    };
 
-    file << "digraph {" << std::endl; //Създава насочен граф, който ще представя графично нашия автомат
-    file << "node [shape = circle];" << std::endl;
-    file << "rankdir=LR;" << std::endl; //Подрежда възлите от ляво надясно
+    //Етикетите се слагат в кавички, затова " и \ се екранират
+    auto appendQuoted = [&buffer](const std::string& text)
+    {
+        buffer += '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                buffer += '\\';
+            }
+            buffer += c;
+        }
+        buffer += '"';
+    };
 
-    file << "n0 [label= \"\", shape=none,height=.0,width=.0]" << std::endl;
+    const size_t n = states.size();
 
-    for (State* state : states) { //Добавя състоянията като възли в графа
-        if (state == startState) {
-            file << "n0 -> " << state->name << std::endl; //Възелът отговарящ на началното състояние, обозначаваме с влизаща стрелка без източник
+    //Показват се първите maxStates състояния в реда на BFS от началното. Останалите се обединяват в един възел
+    std::vector<bool> shown(n, maxStates == 0 || n <= maxStates);
+    size_t hiddenCount = 0;
+    if (maxStates != 0 && n > maxStates)
+    {
+        std::vector<size_t> queue;
+        if (startState)
+        {
+            queue.push_back(startState->id);
+            shown[startState->id] = true;
+        }
+        for (size_t i = 0; i < queue.size() && queue.size() < maxStates; i++)
+        {
+            const State* state = states[queue[i]];
+            auto visit = [&](const State* next)
+            {
+                if (!shown[next->id] && queue.size() < maxStates)
+                {
+                    shown[next->id] = true;
+                    queue.push_back(next->id);
+                }
+            };
+            for (const TransitionRange& range : state->transitions)
+            {
+                for (const State* next : range.destinations)
+                {
+                    visit(next);
+                }
+            }
+            for (const State* next : state->epsilonTransitions)
+            {
+                visit(next);
+            }
         }
-        if (state->isFinal) { 
-            file << state->name << " [shape = doublecircle]; " << std::endl; //Прави възлите, отговарящи на финалните състояния с двоен кръг
+        hiddenCount = n - queue.size();
+    }
+
+    buffer += "digraph {\n"; //Създава насочен граф, който ще представя графично нашия автомат
+    buffer += "node [shape = circle];\n";
+    buffer += "rankdir=LR;\n"; //Подрежда възлите от ляво надясно
+    buffer += "n0 [label= \"\", shape=none,height=.0,width=.0]\n";
+
+    if (startState && shown[startState->id])
+    {
+        buffer += "n0 -> s" + std::to_string(startState->id) + "\n"; //Възелът отговарящ на началното състояние, обозначаваме с влизаща стрелка без източник
+    }
+    if (hiddenCount > 0)
+    {
+        buffer += "collapsed [shape = box, label = \"" + std::to_string(hiddenCount) + " more states\"];\n";
+    }
+
+    //Ребрата от едно състояние се групират по целево състояние, за да се получи по едно ребро с общ етикет
+    const size_t COLLAPSED = n;
+    std::vector<std::pair<size_t, SymbolRange>> edges;
+    std::vector<size_t> epsilonTargets;
+
+    for (const State* state : states)
+    {
+        if (!shown[state->id])
+        {
+            continue;
         }
-        for (char c : alphabet) { //Добавя преходите като ребра в графа
-            for (State* next : state->getTransitions(c)) { 
-                file << state->name << " -> " << next->name << " [label = \"" << c << "\"];" << std::endl;
+
+        buffer += "s" + std::to_string(state->id) + " [label = ";
+        appendQuoted(getStateName(state));
+        buffer += state->isFinal ? ", shape = doublecircle];\n" : "];\n"; //Прави възлите, отговарящи на финалните състояния с двоен кръг
+
+        edges.clear();
+        epsilonTargets.clear();
+        for (const TransitionRange& range : state->transitions)
+        {
+            for (const State* next : range.destinations)
+            {
+                edges.push_back({ shown[next->id] ? next->id : COLLAPSED, { range.low, range.high } });
             }
         }
-        for (State* next : state->getTransitions('@')) { 
-            file << state->name << " -> " << next->name << " [label = \"" << '@' << "\"];" << std::endl;
+        for (const State* next : state->epsilonTransitions)
+        {
+            epsilonTargets.push_back(shown[next->id] ? next->id : COLLAPSED);
         }
-    }
+        std::stable_sort(edges.begin(), edges.end(), [](const std::pair<size_t, SymbolRange>& a, const std::pair<size_t, SymbolRange>& b)
+            { return a.first < b.first; });
+        std::sort(epsilonTargets.begin(), epsilonTargets.end());
+        epsilonTargets.erase(std::unique(epsilonTargets.begin(), epsilonTargets.end()), epsilonTargets.end());
+
+        //Обхождаме целевите състояния в нарастващ ред - първо тези с преходи със символи, после само празните преходи
+        size_t i = 0;
+        size_t e = 0;
+        while (i < edges.size() || e < epsilonTargets.size())
+        {
+            size_t target = i < edges.size() ? edges[i].first : epsilonTargets[e];
+            if (e < epsilonTargets.size() && epsilonTargets[e] < target)
+            {
+                target = epsilonTargets[e];
+            }
+
+            //Интервалите към едно състояние са подредени, затова съседните се сливат направо
+            std::vector<SymbolRange> ranges;
+            for (; i < edges.size() && edges[i].first == target; i++)
+            {
+                const SymbolRange& range = edges[i].second;
+                if (!ranges.empty() && ranges.back().second + 1 == range.first)
+                {
+                    ranges.back().second = range.second;
+                }
+                else
+                {
+                    ranges.push_back(range);
+                }
+            }
+
+            std::string label;
+            for (const SymbolRange& range : ranges)
+            {
+                label += static_cast<char>(range.first);
+                if (range.first != range.second)
+                {
+                    label += '-';
+                    label += static_cast<char>(range.second);
+                }
+            }
+            if (label.size() > 1)
+            {
+                label = "[" + label + "]";
+            }
+            if (e < epsilonTargets.size() && epsilonTargets[e] == target)
+            {
+                label += label.empty() ? "@" : ", @";
+                e++;
+            }
 
-    file << "}" << std::endl;
+            buffer += "s" + std::to_string(state->id) + " -> " + (target == COLLAPSED ? std::string("collapsed") : "s" + std::to_string(target)) + " [label = ";
+            appendQuoted(label);
+            buffer += "];\n";
+            flushIfFull();
+        }
+    }
 
-    file.close();
-}
\ No newline at end of file
+    buffer += "}\n";
+    write(buffer.data(), buffer.size());
+}
@@ -0,0 +1,263 @@
+﻿#include "BitParallelNFA.hpp"
+#include "MemoryLimit.hpp"
+#include <algorithm>
+#include <bitset>
+
+BitParallelNFA::BitParallelNFA(size_t stateCount)
+    : stateCount(stateCount), words((stateCount + 63) / 64), chunks((stateCount + 7) / 8), hasEpsilon(false)
+{
+    classOf.fill(0);
+}
+
+std::unique_ptr<BitParallelNFA> BitParallelNFA::fromNFA(const NFA& nfa)
+{
+    const std::vector<State*>& states = nfa.getStates();
+    const size_t n = states.size();
+    if (n == 0 || n > MAX_STATES || !nfa.getStartState())
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<BitParallelNFA> result(new BitParallelNFA(n));
+    const size_t words = result->words;
+
+    auto setBit = [words](std::vector<uint64_t>& sets, size_t row, size_t bit)
+    {
+        sets[row * words + bit / 64] |= uint64_t(1) << (bit % 64);
+    };
+
+    //Временните масиви по-долу: етикетите и follow и closure с по едно множество за състояние
+    MemoryLimit::charge(n * (2 * sizeof(std::bitset<256>) + 2 * words * sizeof(uint64_t)));
+
+    //labels[t] е етикетът на преходите, влизащи в t. fromSource е етикетът от текущото състояние към всяко друго
+    std::vector<std::bitset<256>> labels(n);
+    std::vector<bool> hasLabel(n, false);
+    std::vector<std::bitset<256>> fromSource(n);
+    std::vector<size_t> touched;
+
+    std::vector<uint64_t> follow(n * words, 0);
+    for (State* state : states)
+    {
+        touched.clear();
+        for (const TransitionRange& range : state->transitions)
+        {
+            for (State* next : range.destinations)
+            {
+                if (fromSource[next->id].none())
+                {
+                    touched.push_back(next->id);
+                }
+                for (int c = range.low; c <= range.high; c++)
+                {
+                    fromSource[next->id].set(c);
+                }
+                setBit(follow, state->id, next->id);
+            }
+        }
+
+        //Всички преходи, влизащи в едно състояние, трябва да имат еднакъв етикет
+        for (size_t target : touched)
+        {
+            if (!hasLabel[target])
+            {
+                labels[target] = fromSource[target];
+                hasLabel[target] = true;
+            }
+            else if (labels[target] != fromSource[target])
+            {
+                return nullptr;
+            }
+            fromSource[target].reset();
+        }
+
+        if (!state->epsilonTransitions.empty())
+        {
+            result->hasEpsilon = true;
+        }
+    }
+
+    //Затваряне по празни преходи за всяко състояние
+    std::vector<uint64_t> closure(n * words, 0);
+    std::vector<bool> visited(n);
+    std::vector<State*> stack;
+    for (State* state : states)
+    {
+        std::fill(visited.begin(), visited.end(), false);
+        visited[state->id] = true;
+        stack.push_back(state);
+        while (!stack.empty())
+        {
+            State* current = stack.back();
+            stack.pop_back();
+            setBit(closure, state->id, current->id);
+            for (State* next : current->epsilonTransitions)
+            {
+                if (!visited[next->id])
+                {
+                    visited[next->id] = true;
+                    stack.push_back(next);
+                }
+            }
+        }
+    }
+
+    //Символите, които никой преход не различава, получават един клас
+    std::vector<SymbolRange> classes = nfa.getSymbolClasses();
+    MemoryLimit::charge((classes.size() + 3) * words * sizeof(uint64_t));
+    result->symbolMasks.assign((classes.size() + 1) * words, 0);
+    for (size_t k = 0; k < classes.size(); k++)
+    {
+        for (int c = classes[k].first; c <= classes[k].second; c++)
+        {
+            result->classOf[c] = static_cast<uint16_t>(k + 1);
+        }
+        for (size_t target = 0; target < n; target++)
+        {
+            if (labels[target].test(classes[k].first))
+            {
+                setBit(result->symbolMasks, k + 1, target);
+            }
+        }
+    }
+
+    result->buildChunkTable(follow, result->followTable);
+    if (result->hasEpsilon)
+    {
+        result->buildChunkTable(closure, result->closureTable);
+    }
+
+    size_t start = nfa.getStartState()->id;
+    result->startMask.assign(closure.begin() + start * words, closure.begin() + (start + 1) * words);
+    result->finalMask.assign(words, 0);
+    for (State* state : states)
+    {
+        if (state->isFinal)
+        {
+            setBit(result->finalMask, 0, state->id);
+        }
+    }
+
+    return result;
+}
+
+size_t BitParallelNFA::memoryUsage() const
+{
+    auto bytes = [](const std::vector<uint64_t>& array) { return array.capacity() * sizeof(uint64_t); };
+    return sizeof(*this) + bytes(symbolMasks) + bytes(followTable) + bytes(closureTable) + bytes(startMask) + bytes(finalMask);
+}
+
+void BitParallelNFA::buildChunkTable(const std::vector<uint64_t>& single, std::vector<uint64_t>& table) const
+{
+    MemoryLimit::charge(chunks * 256 * words * sizeof(uint64_t));
+    table.assign(chunks * 256 * words, 0);
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        uint64_t* base = table.data() + chunk * 256 * words;
+        for (size_t byte = 1; byte < 256; byte++)
+        {
+            //Редът за byte е редът без най-младшия бит, обединен с множеството за състоянието на този бит
+            size_t lowest = 0;
+            while (!(byte & (size_t(1) << lowest)))
+            {
+                lowest++;
+            }
+            size_t state = chunk * 8 + lowest;
+            const uint64_t* previous = base + (byte & (byte - 1)) * words;
+            uint64_t* row = base + byte * words;
+            for (size_t w = 0; w < words; w++)
+            {
+                row[w] = previous[w] | (state < stateCount ? single[state * words + w] : 0);
+            }
+        }
+    }
+}
+
+void BitParallelNFA::lookup(const std::vector<uint64_t>& table, const uint64_t* set, uint64_t* result) const
+{
+    std::fill(result, result + words, 0);
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        size_t byte = (set[chunk / 8] >> ((chunk % 8) * 8)) & 0xff;
+        if (byte == 0)
+        {
+            continue;
+        }
+        const uint64_t* row = table.data() + (chunk * 256 + byte) * words;
+        for (size_t w = 0; w < words; w++)
+        {
+            result[w] |= row[w];
+        }
+    }
+}
+
+void BitParallelNFA::step(const uint64_t* active, uint64_t* next, uint64_t* scratch, unsigned char c) const
+{
+    size_t symbolClass = classOf[c];
+    if (symbolClass == 0)
+    {
+        std::fill(next, next + words, 0);
+        return;
+    }
+
+    const uint64_t* mask = symbolMasks.data() + symbolClass * words;
+    uint64_t* target = hasEpsilon ? scratch : next;
+
+    lookup(followTable, active, target);
+    for (size_t w = 0; w < words; w++)
+    {
+        target[w] &= mask[w];
+    }
+
+    if (hasEpsilon)
+    {
+        lookup(closureTable, scratch, next);
+    }
+}
+
+bool BitParallelNFA::intersects(const uint64_t* set, const std::vector<uint64_t>& mask) const
+{
+    for (size_t w = 0; w < words; w++)
+    {
+        if (set[w] & mask[w])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BitParallelNFA::accepts(const std::string& input) const
+{
+    Matcher matcher(*this);
+    matcher.feed(input);
+    return matcher.isAccepting();
+}
+
+BitParallelNFA::Matcher::Matcher(const BitParallelNFA& automaton)
+    : automaton(automaton), active(automaton.startMask), next(automaton.words), scratch(automaton.words)
+{
+}
+
+void BitParallelNFA::Matcher::reset()
+{
+    active = automaton.startMask;
+}
+
+void BitParallelNFA::Matcher::feed(const char* data, size_t length)
+{
+    for (size_t i = 0; i < length && !isDead(); i++)
+    {
+        automaton.step(active.data(), next.data(), scratch.data(), static_cast<unsigned char>(data[i]));
+        active.swap(next);
+    }
+}
+
+bool BitParallelNFA::Matcher::isAccepting() const
+{
+    return automaton.intersects(active.data(), automaton.finalMask);
+}
+
+bool BitParallelNFA::Matcher::isDead() const
+{
+    return std::all_of(active.begin(), active.end(), [](uint64_t word) { return word == 0; });
+}
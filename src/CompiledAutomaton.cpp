@@ -0,0 +1,1119 @@
+﻿#include "CompiledAutomaton.hpp"
+#include "ArchiveFormat.hpp"
+#include "MemoryLimit.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    //Размерът на масивите на преходите (CSR) за states състояния, edges прехода със символ и epsilons празни прехода
+    size_t csrBytes(size_t states, size_t edges, size_t epsilons)
+    {
+        return states * (sizeof(uint8_t) + 2 * sizeof(uint32_t)) + edges * (sizeof(uint16_t) + sizeof(uint32_t)) + epsilons * sizeof(uint32_t);
+    }
+}
+
+CompiledAutomaton::CompiledAutomaton(const Automaton& automaton) : CompiledAutomaton()
+{
+    const std::vector<State*>& states = automaton.getStates();
+    std::vector<SymbolRange> intervals = automaton.getSymbolClasses();
+
+    //Стълбът на интервал са двойките (състояние, цел) на преходите с него. Интервалите с еднакви стълбове образуват един клас
+    std::map<std::vector<std::pair<uint32_t, uint32_t>>, uint16_t> columnClass;
+    classOf.fill(0);
+    for (const SymbolRange& interval : intervals)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> column;
+        for (State* state : states)
+        {
+            const TransitionRange* range = state->findRange(interval.first);
+            if (!range)
+            {
+                continue;
+            }
+            for (State* destination : range->destinations)
+            {
+                column.push_back({ static_cast<uint32_t>(state->id), static_cast<uint32_t>(destination->id) });
+            }
+        }
+
+        //Стълбът остава в columnClass до края на конструктора
+        MemoryLimit::charge(column.size() * sizeof(column[0]) + sizeof(decltype(columnClass)::value_type) + 4 * sizeof(void*));
+        auto inserted = columnClass.insert({ std::move(column), static_cast<uint16_t>(classCount) });
+        if (inserted.second)
+        {
+            classCount++;
+        }
+        for (int c = interval.first; c <= interval.second; c++)
+        {
+            classOf[c] = inserted.first->second;
+        }
+    }
+
+    //Символ, представящ всеки клас
+    std::vector<unsigned char> representative(classCount, 0);
+    for (int c = 255; c >= 0; c--)
+    {
+        representative[classOf[c]] = static_cast<unsigned char>(c);
+    }
+
+    for (char c : automaton.getAlphabet())
+    {
+        alphabet.set(static_cast<unsigned char>(c));
+    }
+
+    startState = automaton.getStartState() ? static_cast<uint32_t>(automaton.getStartState()->id) : NO_STATE;
+
+    MemoryLimit::charge(csrBytes(states.size() + 1, 0, 0));
+    finals.reserve(states.size());
+    edgeOffsets.reserve(states.size() + 1);
+    epsilonOffsets.reserve(states.size() + 1);
+    edgeOffsets.push_back(0);
+    epsilonOffsets.push_back(0);
+
+    std::vector<uint32_t> targets;
+    for (State* state : states)
+    {
+        finals.push_back(state->isFinal ? 1 : 0);
+
+        for (size_t cls = 1; cls < classCount; cls++)
+        {
+            const TransitionRange* range = state->findRange(representative[cls]);
+            if (!range)
+            {
+                continue;
+            }
+            targets.clear();
+            for (State* destination : range->destinations)
+            {
+                targets.push_back(static_cast<uint32_t>(destination->id));
+            }
+            std::sort(targets.begin(), targets.end());
+            MemoryLimit::charge(csrBytes(0, targets.size(), 0));
+            for (uint32_t target : targets)
+            {
+                edgeClasses.push_back(static_cast<uint16_t>(cls));
+                edgeTargets.push_back(target);
+            }
+        }
+        edgeOffsets.push_back(static_cast<uint32_t>(edgeTargets.size()));
+
+        targets.clear();
+        for (State* destination : state->epsilonTransitions)
+        {
+            targets.push_back(static_cast<uint32_t>(destination->id));
+        }
+        std::sort(targets.begin(), targets.end());
+        MemoryLimit::charge(csrBytes(0, 0, targets.size()));
+        epsilonTargets.insert(epsilonTargets.end(), targets.begin(), targets.end());
+        epsilonOffsets.push_back(static_cast<uint32_t>(epsilonTargets.size()));
+    }
+
+    buildTable();
+}
+
+void CompiledAutomaton::buildTable()
+{
+    const size_t n = finals.size();
+    deterministic = epsilonTargets.empty();
+    for (uint32_t state = 0; state < n && deterministic; state++)
+    {
+        for (size_t edge = edgeOffsets[state] + 1; edge < edgeOffsets[state + 1]; edge++)
+        {
+            if (edgeClasses[edge] == edgeClasses[edge - 1])
+            {
+                deterministic = false;
+                break;
+            }
+        }
+    }
+
+    table.clear();
+    narrowTable.clear();
+    combBase.clear();
+    combNext.clear();
+    combCheck.clear();
+    if (!deterministic)
+    {
+        return;
+    }
+
+    //Преходите към състояния, от които не се достига финално, не влизат в таблицата. Така разпознаването спира още
+    //при влизането в мъртво състояние (например в неприемащото състояние за поглъщане след допълнение), а не в края на входа
+    std::vector<bool> live = liveStates();
+
+    size_t denseBytes = n * classCount * (n < NO_NARROW_STATE ? sizeof(uint16_t) : sizeof(uint32_t));
+    if (denseBytes >= COMB_MIN_DENSE_BYTES && buildCombTable(denseBytes, live))
+    {
+        return;
+    }
+
+    MemoryLimit::charge(denseBytes);
+    if (n < NO_NARROW_STATE)
+    {
+        narrowTable.assign(n * classCount, NO_NARROW_STATE);
+    }
+    else
+    {
+        table.assign(n * classCount, NO_STATE);
+    }
+    for (uint32_t state = 0; state < n; state++)
+    {
+        for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+        {
+            if (!live[edgeTargets[edge]])
+            {
+                continue;
+            }
+            if (!narrowTable.empty())
+            {
+                narrowTable[state * classCount + edgeClasses[edge]] = static_cast<uint16_t>(edgeTargets[edge]);
+            }
+            else
+            {
+                table[state * classCount + edgeClasses[edge]] = edgeTargets[edge];
+            }
+        }
+    }
+}
+
+std::vector<bool> CompiledAutomaton::liveStates() const
+{
+    const size_t n = finals.size();
+
+    //Обратните ребра в CSR масиви, после BFS назад от финалните състояния
+    MemoryLimit::charge((3 * n + 1 + edgeTargets.size() + epsilonTargets.size()) * sizeof(uint32_t) + n / 8 + 1);
+    std::vector<uint32_t> offsets(n + 1, 0);
+    for (uint32_t target : edgeTargets)
+    {
+        offsets[target + 1]++;
+    }
+    for (uint32_t target : epsilonTargets)
+    {
+        offsets[target + 1]++;
+    }
+    for (size_t state = 0; state < n; state++)
+    {
+        offsets[state + 1] += offsets[state];
+    }
+    std::vector<uint32_t> sources(offsets[n]);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t state = 0; state < n; state++)
+    {
+        for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+        {
+            sources[fill[edgeTargets[edge]]++] = state;
+        }
+        for (size_t edge = epsilonOffsets[state]; edge < epsilonOffsets[state + 1]; edge++)
+        {
+            sources[fill[epsilonTargets[edge]]++] = state;
+        }
+    }
+
+    std::vector<bool> live(n, false);
+    std::vector<uint32_t> queue;
+    for (uint32_t state = 0; state < n; state++)
+    {
+        if (finals[state])
+        {
+            live[state] = true;
+            queue.push_back(state);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        for (size_t k = offsets[queue[i]]; k < offsets[queue[i] + 1]; k++)
+        {
+            if (!live[sources[k]])
+            {
+                live[sources[k]] = true;
+                queue.push_back(sources[k]);
+            }
+        }
+    }
+    return live;
+}
+
+bool CompiledAutomaton::buildCombTable(size_t denseBytes, const std::vector<bool>& live)
+{
+    const uint32_t n = static_cast<uint32_t>(finals.size());
+
+    //order и base. check, targets и nextFree се отчитат, когато растат
+    MemoryLimit::charge(2 * size_t(n) * sizeof(uint32_t));
+    const size_t slotBytes = 2 * sizeof(uint32_t) + sizeof(size_t);
+
+    //Редовете с повече преходи се нареждат първи, докато има повече свободни места
+    std::vector<uint32_t> order(n);
+    for (uint32_t state = 0; state < n; state++)
+    {
+        order[state] = state;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return edgeOffsets[a + 1] - edgeOffsets[a] > edgeOffsets[b + 1] - edgeOffsets[b];
+    });
+
+    //Живите преходи на реда, който се разполага
+    std::vector<std::pair<uint16_t, uint32_t>> row;
+
+    std::vector<uint32_t> base(n, 0);
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> check;
+
+    //nextFree води към следващата свободна позиция (nextFree[slot] == slot за свободните) и се съкращава при всяко търсене,
+    //за да не се обхождат многократно заетите участъци. Позициите след края на масивите са свободни
+    std::vector<size_t> nextFree;
+    auto findFree = [&nextFree](size_t slot) {
+        size_t free = slot;
+        while (free < nextFree.size() && nextFree[free] != free)
+        {
+            free = nextFree[free];
+        }
+        while (slot < nextFree.size() && nextFree[slot] != slot)
+        {
+            size_t following = nextFree[slot];
+            nextFree[slot] = free;
+            slot = following;
+        }
+        return free;
+    };
+
+    for (uint32_t state : order)
+    {
+        row.clear();
+        for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+        {
+            if (live[edgeTargets[edge]])
+            {
+                row.push_back({ edgeClasses[edge], edgeTargets[edge] });
+            }
+        }
+        if (row.empty())
+        {
+            continue; //Ред без преходи не заема място - check никъде не е равен на state
+        }
+
+        //Първото отместване, при което всички класове на реда попадат на свободни позиции. Класовете са подредени,
+        //затова се пробват само отместванията, при които първият клас попада на свободна позиция. След COMB_MAX_PROBES
+        //неуспешни опита редът се поставя след края на масивите, където всички позиции са свободни
+        size_t offset = 0;
+        size_t probes = 0;
+        for (size_t first = findFree(row[0].first);; first = findFree(first + 1))
+        {
+            if (++probes > COMB_MAX_PROBES)
+            {
+                offset = check.size();
+                break;
+            }
+            offset = first - row[0].first;
+            bool fits = true;
+            for (size_t edge = 1; edge < row.size() && fits; edge++)
+            {
+                size_t slot = offset + row[edge].first;
+                fits = slot >= check.size() || check[slot] == NO_STATE;
+            }
+            if (fits)
+            {
+                break;
+            }
+        }
+
+        base[state] = static_cast<uint32_t>(offset);
+        for (const auto& edge : row)
+        {
+            size_t slot = offset + edge.first;
+            if (slot >= check.size())
+            {
+                MemoryLimit::charge((slot + 1 - check.size()) * slotBytes);
+                check.resize(slot + 1, NO_STATE);
+                targets.resize(slot + 1, NO_STATE);
+                while (nextFree.size() < check.size())
+                {
+                    nextFree.push_back(nextFree.size());
+                }
+            }
+            check[slot] = state;
+            targets[slot] = edge.second;
+            nextFree[slot] = slot + 1;
+        }
+
+        if ((n + 2 * check.size()) * sizeof(uint32_t) * COMB_MIN_RATIO > denseBytes)
+        {
+            return false;
+        }
+    }
+
+    //Всеки ред може да се чете до base + classCount - 1, затова масивите се допълват
+    size_t size = 0;
+    for (uint32_t state = 0; state < n; state++)
+    {
+        size = std::max(size, base[state] + classCount);
+    }
+    if (size > check.size())
+    {
+        MemoryLimit::charge((size - check.size()) * 2 * sizeof(uint32_t));
+    }
+    check.resize(std::max(size, check.size()), NO_STATE);
+    targets.resize(check.size(), NO_STATE);
+
+    combBase = std::move(base);
+    combNext = std::move(targets);
+    combCheck = std::move(check);
+    return true;
+}
+
+template <typename Target>
+uint32_t CompiledAutomaton::run(const std::vector<Target>& transitions, Target none, uint32_t state, const char* data, size_t length) const
+{
+    Target current = static_cast<Target>(state);
+    for (size_t i = 0; i < length; i++)
+    {
+        current = transitions[current * classCount + classOf[static_cast<unsigned char>(data[i])]];
+        if (current == none)
+        {
+            return NO_STATE;
+        }
+    }
+    return current;
+}
+
+uint32_t CompiledAutomaton::runTable(uint32_t state, const char* data, size_t length) const
+{
+    if (!combBase.empty())
+    {
+        for (size_t i = 0; i < length && state != NO_STATE; i++)
+        {
+            size_t slot = combBase[state] + classOf[static_cast<unsigned char>(data[i])];
+            state = combCheck[slot] == state ? combNext[slot] : NO_STATE;
+        }
+        return state;
+    }
+    if (!narrowTable.empty())
+    {
+        return run(narrowTable, NO_NARROW_STATE, state, data, length);
+    }
+    return run(table, NO_STATE, state, data, length);
+}
+
+size_t CompiledAutomaton::memoryUsage() const
+{
+    auto bytes = [](const auto& array) { return array.capacity() * sizeof(array[0]); };
+    return sizeof(*this) + bytes(finals) + bytes(edgeOffsets) + bytes(edgeClasses) + bytes(edgeTargets)
+        + bytes(epsilonOffsets) + bytes(epsilonTargets) + bytes(table) + bytes(narrowTable)
+        + bytes(combBase) + bytes(combNext) + bytes(combCheck);
+}
+
+std::vector<SymbolRange> CompiledAutomaton::getClassRanges(uint16_t cls) const
+{
+    std::vector<SymbolRange> ranges;
+    for (int c = 0; c < 256; c++)
+    {
+        if (classOf[c] != cls)
+        {
+            continue;
+        }
+        if (!ranges.empty() && ranges.back().second + 1 == c)
+        {
+            ranges.back().second = static_cast<unsigned char>(c);
+        }
+        else
+        {
+            ranges.push_back({ static_cast<unsigned char>(c), static_cast<unsigned char>(c) });
+        }
+    }
+    return ranges;
+}
+
+bool CompiledAutomaton::accepts(const char* input, size_t length) const
+{
+    if (startState == NO_STATE)
+    {
+        return false;
+    }
+
+    if (deterministic)
+    {
+        uint32_t state = runTable(startState, input, length);
+        return state != NO_STATE && finals[state] != 0;
+    }
+
+    SparseSet currentStates(finals.size());
+    SparseSet nextStates(finals.size());
+    std::vector<uint32_t> stack;
+    stack.reserve(finals.size());
+
+    addWithEpsilonClosure(currentStates, startState, stack);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        step(currentStates, nextStates, stack, classOf[static_cast<unsigned char>(input[i])]);
+        std::swap(currentStates, nextStates);
+        if (currentStates.empty())
+        {
+            return false;
+        }
+    }
+
+    return containsFinal(currentStates);
+}
+
+bool CompiledAutomaton::acceptsParallel(const char* input, size_t length, unsigned threadCount) const
+{
+    const size_t n = finals.size();
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunkCount = std::min<size_t>(threadCount, length / PARALLEL_MIN_CHUNK);
+    if (startState == NO_STATE || !deterministic || n > PARALLEL_MAX_STATES || chunkCount < 2)
+    {
+        return accepts(input, length);
+    }
+
+    //Частите след първата се обработват от отделни нишки, а първата - от текущата, направо от началното състояние
+    size_t chunkSize = length / chunkCount;
+    std::vector<std::vector<uint32_t>> mappings(chunkCount);
+    std::vector<std::thread> workers;
+    workers.reserve(chunkCount - 1);
+    for (size_t chunk = 1; chunk < chunkCount; chunk++)
+    {
+        size_t begin = chunk * chunkSize;
+        size_t chunkLength = chunk + 1 == chunkCount ? length - begin : chunkSize;
+        workers.emplace_back([this, input, &mappings, chunk, begin, chunkLength]() {
+            runFromAllStates(input + begin, chunkLength, mappings[chunk]);
+        });
+    }
+
+    uint32_t state = runTable(startState, input, chunkSize);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    for (size_t chunk = 1; chunk < chunkCount && state != NO_STATE; chunk++)
+    {
+        state = mappings[chunk][state];
+    }
+    return state != NO_STATE && finals[state] != 0;
+}
+
+void CompiledAutomaton::runFromAllStates(const char* data, size_t length, std::vector<uint32_t>& mapping) const
+{
+    //Сливаме симулациите на блокове: след всеки блок еднаквите текущи състояния стават една симулация
+    const size_t BLOCK = 256;
+    const uint32_t n = static_cast<uint32_t>(finals.size());
+
+    std::vector<uint32_t> active(n);    //Различните текущи състояния
+    std::vector<uint32_t> simulation(n); //За всяко начално състояние - индексът на симулацията му в active
+    for (uint32_t state = 0; state < n; state++)
+    {
+        active[state] = state;
+        simulation[state] = state;
+    }
+
+    std::vector<uint32_t> merged(n, NO_STATE); //Новият индекс в active на всяко текущо състояние
+    std::vector<uint32_t> remap;
+    std::vector<uint32_t> survivors;
+    for (size_t position = 0; position < length && !active.empty(); position += BLOCK)
+    {
+        size_t blockLength = std::min(BLOCK, length - position);
+        remap.assign(active.size(), NO_STATE);
+        survivors.clear();
+        for (size_t i = 0; i < active.size(); i++)
+        {
+            uint32_t state = runTable(active[i], data + position, blockLength);
+            if (state == NO_STATE)
+            {
+                continue;
+            }
+            uint32_t& index = merged[state];
+            if (index == NO_STATE)
+            {
+                index = static_cast<uint32_t>(survivors.size());
+                survivors.push_back(state);
+            }
+            remap[i] = index;
+        }
+        for (uint32_t state : survivors)
+        {
+            merged[state] = NO_STATE;
+        }
+        for (uint32_t& index : simulation)
+        {
+            if (index != NO_STATE)
+            {
+                index = remap[index];
+            }
+        }
+        active.swap(survivors);
+    }
+
+    mapping.resize(n);
+    for (uint32_t state = 0; state < n; state++)
+    {
+        mapping[state] = simulation[state] == NO_STATE ? NO_STATE : active[simulation[state]];
+    }
+}
+
+void CompiledAutomaton::step(const SparseSet& current, SparseSet& next, std::vector<uint32_t>& stack, uint16_t cls) const
+{
+    next.clear();
+    if (cls == 0)
+    {
+        return;
+    }
+
+    for (size_t state : current)
+    {
+        //Преходите са подредени по клас, затова търсим двоично тези с текущия клас
+        auto first = edgeClasses.begin() + edgeOffsets[state];
+        auto last = edgeClasses.begin() + edgeOffsets[state + 1];
+        for (auto it = std::lower_bound(first, last, cls); it != last && *it == cls; ++it)
+        {
+            addWithEpsilonClosure(next, edgeTargets[it - edgeClasses.begin()], stack);
+        }
+    }
+}
+
+bool CompiledAutomaton::containsFinal(const SparseSet& set) const
+{
+    for (size_t state : set)
+    {
+        if (finals[state])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CompiledAutomaton::addWithEpsilonClosure(SparseSet& set, uint32_t state, std::vector<uint32_t>& stack) const
+{
+    if (!set.insert(state))
+    {
+        return;
+    }
+
+    stack.clear();
+    stack.push_back(state);
+    while (!stack.empty())
+    {
+        uint32_t current = stack.back();
+        stack.pop_back();
+        for (size_t edge = epsilonOffsets[current]; edge < epsilonOffsets[current + 1]; edge++)
+        {
+            if (set.insert(epsilonTargets[edge]))
+            {
+                stack.push_back(epsilonTargets[edge]);
+            }
+        }
+    }
+}
+
+CompiledAutomaton::Matcher::Matcher(std::shared_ptr<const CompiledAutomaton> automaton)
+    : automaton(std::move(automaton)), state(NO_STATE),
+    current(this->automaton && !this->automaton->deterministic ? this->automaton->getStateCount() : 0),
+    next(this->automaton && !this->automaton->deterministic ? this->automaton->getStateCount() : 0)
+{
+    if (this->automaton && !this->automaton->deterministic)
+    {
+        stack.reserve(this->automaton->getStateCount());
+    }
+    reset();
+}
+
+void CompiledAutomaton::Matcher::reset()
+{
+    current.clear();
+    if (!automaton)
+    {
+        state = NO_STATE;
+        return;
+    }
+    state = automaton->startState;
+    if (!automaton->deterministic && state != NO_STATE)
+    {
+        automaton->addWithEpsilonClosure(current, state, stack);
+    }
+}
+
+void CompiledAutomaton::Matcher::feed(const char* data, size_t length)
+{
+    if (!automaton)
+    {
+        return;
+    }
+    const CompiledAutomaton& a = *automaton;
+    if (a.deterministic)
+    {
+        if (state != NO_STATE)
+        {
+            state = a.runTable(state, data, length);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < length && !current.empty(); i++)
+    {
+        a.step(current, next, stack, a.classOf[static_cast<unsigned char>(data[i])]);
+        std::swap(current, next);
+    }
+}
+
+bool CompiledAutomaton::Matcher::isAccepting() const
+{
+    if (!automaton)
+    {
+        return false;
+    }
+    if (automaton->deterministic)
+    {
+        return state != NO_STATE && automaton->finals[state];
+    }
+    return automaton->containsFinal(current);
+}
+
+bool CompiledAutomaton::Matcher::isDead() const
+{
+    return !automaton || (automaton->deterministic ? state == NO_STATE : current.empty());
+}
+
+bool CompiledAutomaton::Matcher::accepts(const std::string& input)
+{
+    reset();
+    feed(input);
+    return isAccepting();
+}
+
+void CompiledAutomaton::save(std::ostream& out, bool compress, const std::vector<std::string>* names) const
+{
+    const size_t n = finals.size();
+
+    out.write("FAUT", 4);
+    ArchiveWriter::writeRawVarint(out, FORMAT_VERSION);
+    ArchiveWriter::writeRawVarint(out, names ? FLAG_NAMES : 0);
+
+    ArchiveWriter writer(out, compress);
+    writer.writeVarint(n);
+    writer.writeVarint(classCount);
+
+    //Класовете на символите като поредици от еднакви класове: (дължина - 1, клас)
+    std::vector<std::pair<size_t, uint16_t>> runs;
+    for (int c = 0; c < 256; c++)
+    {
+        if (!runs.empty() && runs.back().second == classOf[c])
+        {
+            runs.back().first++;
+        }
+        else
+        {
+            runs.push_back({ 1, classOf[c] });
+        }
+    }
+    writer.writeVarint(runs.size());
+    for (const auto& run : runs)
+    {
+        writer.writeVarint(run.first - 1);
+        writer.writeVarint(run.second);
+    }
+
+    //Азбуката като 32 байта побитово
+    for (int byte = 0; byte < 32; byte++)
+    {
+        uint8_t bits = 0;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            if (alphabet.test(byte * 8 + bit))
+            {
+                bits |= 1 << bit;
+            }
+        }
+        writer.writeByte(bits);
+    }
+
+    writer.writeVarint(startState == NO_STATE ? 0 : uint64_t(startState) + 1);
+
+    //Финалните състояния като разлики между поредните индекси
+    std::vector<uint32_t> finalStates;
+    for (uint32_t state = 0; state < n; state++)
+    {
+        if (finals[state])
+        {
+            finalStates.push_back(state);
+        }
+    }
+    writer.writeVarint(finalStates.size());
+    uint32_t previous = 0;
+    for (uint32_t state : finalStates)
+    {
+        writer.writeVarint(state - previous);
+        previous = state;
+    }
+
+    //Преходите на всяко състояние: разлика на класа спрямо предишния преход и отместване на целта спрямо състоянието.
+    //Автоматите от конструкциите обикновено имат преходи към близки индекси, затова отместванията са малки
+    for (uint32_t state = 0; state < n; state++)
+    {
+        writer.writeVarint(edgeOffsets[state + 1] - edgeOffsets[state]);
+        uint16_t previousClass = 0;
+        for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+        {
+            writer.writeVarint(edgeClasses[edge] - previousClass);
+            writer.writeSignedVarint(int64_t(edgeTargets[edge]) - int64_t(state));
+            previousClass = edgeClasses[edge];
+        }
+
+        writer.writeVarint(epsilonOffsets[state + 1] - epsilonOffsets[state]);
+        for (size_t edge = epsilonOffsets[state]; edge < epsilonOffsets[state + 1]; edge++)
+        {
+            writer.writeSignedVarint(int64_t(epsilonTargets[edge]) - int64_t(state));
+        }
+    }
+
+    if (names)
+    {
+        for (uint32_t state = 0; state < n; state++)
+        {
+            const std::string& name = state < names->size() ? (*names)[state] : std::string();
+            writer.writeVarint(name.size());
+            writer.writeBytes(name.data(), name.size());
+        }
+    }
+
+    writer.finish();
+}
+
+void CompiledAutomaton::saveToFile(const std::string& fileName, bool compress, const std::vector<std::string>* names) const
+{
+    std::ofstream file(fileName, std::ios::out | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::invalid_argument("Could not open file for writing.");
+    }
+
+    save(file, compress, names);
+}
+
+std::unique_ptr<CompiledAutomaton> CompiledAutomaton::load(std::istream& in, std::vector<std::string>* names)
+{
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "FAUT")
+    {
+        throw std::runtime_error("Not an automaton file.");
+    }
+    if (ArchiveReader::readRawVarint(in) != FORMAT_VERSION)
+    {
+        throw std::runtime_error("Unsupported automaton file version.");
+    }
+    uint64_t flags = ArchiveReader::readRawVarint(in);
+
+    ArchiveReader reader(in);
+    std::unique_ptr<CompiledAutomaton> result(new CompiledAutomaton());
+    CompiledAutomaton& automaton = *result;
+
+    auto corrupt = []() { return std::runtime_error("Corrupt automaton file."); };
+
+    uint64_t n = reader.readVarint();
+    automaton.classCount = reader.readVarint();
+    if (n >= NO_STATE || automaton.classCount == 0 || automaton.classCount > 256)
+    {
+        throw corrupt();
+    }
+
+    uint64_t runCount = reader.readVarint();
+    size_t symbol = 0;
+    for (uint64_t run = 0; run < runCount; run++)
+    {
+        uint64_t length = reader.readVarint() + 1;
+        uint64_t cls = reader.readVarint();
+        if (length > 256 - symbol || cls >= automaton.classCount)
+        {
+            throw corrupt();
+        }
+        for (uint64_t k = 0; k < length; k++)
+        {
+            automaton.classOf[symbol++] = static_cast<uint16_t>(cls);
+        }
+    }
+    if (symbol != 256)
+    {
+        throw corrupt();
+    }
+
+    for (int byte = 0; byte < 32; byte++)
+    {
+        uint8_t bits = reader.readByte();
+        for (int bit = 0; bit < 8; bit++)
+        {
+            automaton.alphabet.set(byte * 8 + bit, (bits >> bit) & 1);
+        }
+    }
+
+    uint64_t start = reader.readVarint();
+    if (start > n)
+    {
+        throw corrupt();
+    }
+    automaton.startState = start == 0 ? NO_STATE : static_cast<uint32_t>(start - 1);
+
+    //Броят на състоянията идва от файла, затова паметта се заделя постепенно, докато данните наистина се четат
+    uint64_t finalCount = reader.readVarint();
+    if (finalCount > n)
+    {
+        throw corrupt();
+    }
+    std::vector<uint32_t> finalStates;
+    uint64_t previous = 0;
+    for (uint64_t i = 0; i < finalCount; i++)
+    {
+        previous += reader.readVarint();
+        if (previous >= n)
+        {
+            throw corrupt();
+        }
+        finalStates.push_back(static_cast<uint32_t>(previous));
+    }
+
+    auto readTarget = [&reader, n, &corrupt](uint64_t state) {
+        int64_t target = int64_t(state) + reader.readSignedVarint();
+        if (target < 0 || uint64_t(target) >= n)
+        {
+            throw corrupt();
+        }
+        return static_cast<uint32_t>(target);
+    };
+
+    automaton.edgeOffsets.push_back(0);
+    automaton.epsilonOffsets.push_back(0);
+    for (uint64_t state = 0; state < n; state++)
+    {
+        uint64_t edgeCount = reader.readVarint();
+        MemoryLimit::charge(csrBytes(1, 0, 0));
+        uint64_t cls = 0;
+        for (uint64_t i = 0; i < edgeCount; i++)
+        {
+            cls += reader.readVarint();
+            if (cls == 0 || cls >= automaton.classCount)
+            {
+                throw corrupt();
+            }
+            uint32_t target = readTarget(state);
+            MemoryLimit::charge(csrBytes(0, 1, 0));
+            //Преходите трябва да са подредени по клас и после по цел, без повторения
+            if (i > 0 && automaton.edgeClasses.back() == cls && automaton.edgeTargets.back() >= target)
+            {
+                throw corrupt();
+            }
+            automaton.edgeClasses.push_back(static_cast<uint16_t>(cls));
+            automaton.edgeTargets.push_back(target);
+        }
+        automaton.edgeOffsets.push_back(static_cast<uint32_t>(automaton.edgeTargets.size()));
+
+        uint64_t epsilonCount = reader.readVarint();
+        for (uint64_t i = 0; i < epsilonCount; i++)
+        {
+            MemoryLimit::charge(csrBytes(0, 0, 1));
+            automaton.epsilonTargets.push_back(readTarget(state));
+        }
+        automaton.epsilonOffsets.push_back(static_cast<uint32_t>(automaton.epsilonTargets.size()));
+    }
+
+    automaton.finals.assign(n, 0);
+    for (uint32_t state : finalStates)
+    {
+        automaton.finals[state] = 1;
+    }
+
+    if (names)
+    {
+        names->assign(n, std::string());
+    }
+    if (flags & FLAG_NAMES)
+    {
+        for (uint64_t state = 0; state < n; state++)
+        {
+            uint64_t length = reader.readVarint();
+            std::string name;
+            for (uint64_t i = 0; i < length; i++)
+            {
+                name += static_cast<char>(reader.readByte());
+            }
+            if (names)
+            {
+                (*names)[state] = std::move(name);
+            }
+        }
+    }
+
+    reader.expectEnd();
+    automaton.buildTable();
+    return result;
+}
+
+std::unique_ptr<CompiledAutomaton> CompiledAutomaton::loadFromFile(const std::string& fileName, std::vector<std::string>* names)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::invalid_argument("Could not open file for reading.");
+    }
+
+    return load(file, names);
+}
+
+std::vector<uint64_t> CompiledAutomaton::profile(const std::vector<std::string>& corpus) const
+{
+    std::vector<uint64_t> visits(finals.size(), 0);
+    if (startState == NO_STATE)
+    {
+        return visits;
+    }
+
+    if (deterministic)
+    {
+        for (const std::string& input : corpus)
+        {
+            uint32_t state = startState;
+            visits[state]++;
+            for (char symbol : input)
+            {
+                state = next(state, static_cast<unsigned char>(symbol));
+                if (state == NO_STATE)
+                {
+                    break;
+                }
+                visits[state]++;
+            }
+        }
+        return visits;
+    }
+
+    SparseSet currentStates(finals.size());
+    SparseSet nextStates(finals.size());
+    std::vector<uint32_t> stack;
+    for (const std::string& input : corpus)
+    {
+        currentStates.clear();
+        addWithEpsilonClosure(currentStates, startState, stack);
+        for (size_t i = 0; !currentStates.empty(); i++)
+        {
+            for (size_t state : currentStates)
+            {
+                visits[state]++;
+            }
+            if (i == input.size())
+            {
+                break;
+            }
+            step(currentStates, nextStates, stack, classOf[static_cast<unsigned char>(input[i])]);
+            std::swap(currentStates, nextStates);
+        }
+    }
+    return visits;
+}
+
+std::shared_ptr<const CompiledAutomaton> CompiledAutomaton::renumbered(const std::vector<uint64_t>& visits, std::vector<uint32_t>* newIds) const
+{
+    const size_t n = finals.size();
+    if (visits.size() != n)
+    {
+        throw std::invalid_argument("Visit counts do not match the number of states.");
+    }
+
+    //Ред на BFS от началното състояние, последван от недостижимите състояния
+    std::vector<uint32_t> order;
+    order.reserve(n);
+    std::vector<bool> seen(n, false);
+    auto enqueue = [&](uint32_t state) {
+        if (!seen[state])
+        {
+            seen[state] = true;
+            order.push_back(state);
+        }
+    };
+    if (startState != NO_STATE)
+    {
+        enqueue(startState);
+    }
+    size_t processed = 0;
+    for (uint32_t root = 0; root < n; root++)
+    {
+        enqueue(root);
+        while (processed < order.size())
+        {
+            uint32_t state = order[processed++];
+            for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+            {
+                enqueue(edgeTargets[edge]);
+            }
+            for (size_t edge = epsilonOffsets[state]; edge < epsilonOffsets[state + 1]; edge++)
+            {
+                enqueue(epsilonTargets[edge]);
+            }
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&visits](uint32_t a, uint32_t b) { return visits[a] > visits[b]; });
+
+    std::vector<uint32_t> renumber(n);
+    for (uint32_t id = 0; id < n; id++)
+    {
+        renumber[order[id]] = id;
+    }
+
+    MemoryLimit::charge(csrBytes(n + 1, edgeTargets.size(), epsilonTargets.size()));
+    std::shared_ptr<CompiledAutomaton> result(new CompiledAutomaton());
+    result->classOf = classOf;
+    result->classCount = classCount;
+    result->alphabet = alphabet;
+    result->startState = startState == NO_STATE ? NO_STATE : renumber[startState];
+    result->finals.reserve(n);
+    result->edgeOffsets.reserve(n + 1);
+    result->edgeClasses.reserve(edgeClasses.size());
+    result->edgeTargets.reserve(edgeTargets.size());
+    result->epsilonOffsets.reserve(n + 1);
+    result->epsilonTargets.reserve(epsilonTargets.size());
+    result->edgeOffsets.push_back(0);
+    result->epsilonOffsets.push_back(0);
+
+    std::vector<std::pair<uint16_t, uint32_t>> edges;
+    std::vector<uint32_t> targets;
+    for (uint32_t state : order)
+    {
+        result->finals.push_back(finals[state]);
+
+        //Преходите остават подредени по клас и после по новия индекс на целта
+        edges.clear();
+        for (size_t edge = edgeOffsets[state]; edge < edgeOffsets[state + 1]; edge++)
+        {
+            edges.push_back({ edgeClasses[edge], renumber[edgeTargets[edge]] });
+        }
+        std::sort(edges.begin(), edges.end());
+        for (const auto& edge : edges)
+        {
+            result->edgeClasses.push_back(edge.first);
+            result->edgeTargets.push_back(edge.second);
+        }
+        result->edgeOffsets.push_back(static_cast<uint32_t>(result->edgeTargets.size()));
+
+        targets.clear();
+        for (size_t edge = epsilonOffsets[state]; edge < epsilonOffsets[state + 1]; edge++)
+        {
+            targets.push_back(renumber[epsilonTargets[edge]]);
+        }
+        std::sort(targets.begin(), targets.end());
+        result->epsilonTargets.insert(result->epsilonTargets.end(), targets.begin(), targets.end());
+        result->epsilonOffsets.push_back(static_cast<uint32_t>(result->epsilonTargets.size()));
+    }
+
+    result->buildTable();
+
+    if (newIds)
+    {
+        *newIds = std::move(renumber);
+    }
+    return result;
+}
\ No newline at end of file
@@ -1,13 +1,16 @@
 ﻿#include "DFA.hpp"
+#include "MemoryLimit.hpp"
+#include "NFA.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string>
 
 State* DFA::getNextState(State* state, char c) const
 {
-    std::vector<State*> nextTrans = getNextStates(state, c);
-    if (nextTrans.empty())
+    const TransitionRange* range = state->findRange(static_cast<unsigned char>(c));
+    if (!range)
         return nullptr;
-    return nextTrans.at(0);
+    return range->destinations.at(0);
 }
 
 void DFA::addTransition(State* source, char c, State* destination)
@@ -22,15 +25,35 @@ void DFA::addTransition(State* source, char c, State* destination)
 
     if (source->hasTransition(c)) //Ако вече съществува преход с този символ от това състояние, не го добавяме
     {
-        std::cerr << "Cannot add transition: " << source->name << "--" << c << "-->" << destination->name << std::endl;
+        std::cerr << "Cannot add transition: " << getStateName(source) << "--" << c << "-->" << getStateName(destination) << std::endl;
         return;
     }
     source->addTransition(c, destination);
 }
 
+void DFA::addRangeTransition(State* source, unsigned char low, unsigned char high, State* destination)
+{
+    //Ако вече съществува преход с някой от символите в интервала от това състояние, не го добавяме
+    for (const TransitionRange& range : source->transitions)
+    {
+        if (range.low <= high && low <= range.high)
+        {
+            std::cerr << "Cannot add transition: " << getStateName(source) << "--" << rangeToString(low, high) << "-->" << getStateName(destination) << std::endl;
+            return;
+        }
+    }
+
+    addRangeToAlphabet(low, high);
+    source->addTransition(low, high, destination);
+}
+
 bool DFA::accepts(const std::string& input) const
 {
     State* current = getStartState();
+    if (!current)
+    {
+        return false;
+    }
     for (char c : input)
     {
         current = getNextState(current, c);
@@ -44,187 +67,499 @@ bool DFA::accepts(const std::string& input) const
     return true;
 }
 
-DFA* DFA::intersectWith(const DFA& other) const
+namespace
 {
-    //Намираме обща азбука на двата автомата
-    std::unordered_set<char> commonAlphabet;
-    for (char c : getAlphabet())
+    //Символите от азбуката, групирани в интервали от последователни символи
+    std::vector<SymbolRange> alphabetRanges(const std::unordered_set<char>& alphabet)
     {
-        if (other.getAlphabet().find(c) != other.getAlphabet().end())
+        std::vector<unsigned char> symbols;
+        symbols.reserve(alphabet.size());
+        for (char c : alphabet)
         {
-            commonAlphabet.insert(c);
+            symbols.push_back(static_cast<unsigned char>(c));
         }
+        std::sort(symbols.begin(), symbols.end());
+
+        std::vector<SymbolRange> ranges;
+        for (unsigned char c : symbols)
+        {
+            if (!ranges.empty() && ranges.back().second + 1 == c)
+            {
+                ranges.back().second = c;
+            }
+            else
+            {
+                ranges.push_back({ c, c });
+            }
+        }
+        return ranges;
     }
+}
 
-    DFA* result = new DFA();
+template <typename OnState, typename OnTransition>
+bool DFA::exploreProduct(const DFA& other, const std::function<bool(bool, bool)>& combine, OnState onState, OnTransition onTransition) const
+{
+    //Стойностите на combine се пресмятат веднъж, за да не се извиква std::function за всяка двойка
+    const bool accepting[2][2] = { { combine(false, false), combine(false, true) }, { combine(true, false), combine(true, true) } };
 
-    //Персонализирана хешираща функция
-    std::unordered_map<std::pair<State*, State*>, State*, PairHash> stateMap;
+    const std::vector<State*>& statesA = getStates();
+    const std::vector<State*>& statesB = other.getStates();
+    const size_t sinkA = statesA.size();
+    const size_t sinkB = statesB.size();
 
-    State* thisStart = this->getStartState();
-    State* otherStart = other.getStartState();
-    State* start = result->addState(thisStart->name + "_" + otherStart->name, thisStart->isFinal && otherStart->isFinal);
-    result->setStartState(start);
-    stateMap[{thisStart, otherStart}] = start;
+    //Двойка, в която едната страна е мъртва, приема според другата страна. Ако combine е false и в двата случая, от нея не се достига финална
+    //двойка и не се обхожда. Такава е и двойката от две мъртви състояния, ако combine(false, false) е false
+    auto isDead = [&](size_t i, size_t j)
+    {
+        return (i == sinkA && !accepting[0][0] && (j == sinkB || !accepting[0][1]))
+            || (j == sinkB && !accepting[0][0] && !accepting[1][0]);
+    };
 
-    std::queue<std::pair<State*, State*>> queue;
-    queue.push({ thisStart, otherStart });
+    size_t startA = getStartState() ? getStartState()->id : sinkA;
+    size_t startB = other.getStartState() ? other.getStartState()->id : sinkB;
+    if (isDead(startA, startB))
+    {
+        return true;
+    }
 
-    //Използваме BFS, за да построим резултатния автомат
-    while (!queue.empty())
+    //Символите без преход и в двата автомата водят в мъртвата двойка, но само ако са от азбуката на някой от тях
+    std::vector<SymbolRange> alphabet;
+    std::vector<bool> inAlphabet(256, false);
+    if (accepting[0][0])
     {
-        std::pair<State*, State*> current = queue.front();
-        queue.pop();
+        std::unordered_set<char> symbols(getAlphabet());
+        symbols.insert(other.getAlphabet().begin(), other.getAlphabet().end());
+        alphabet = alphabetRanges(symbols);
+        for (char c : symbols)
+        {
+            inAlphabet[static_cast<unsigned char>(c)] = true;
+        }
+    }
+
+    PairIndex index(sinkA + 1, sinkB + 1);
+    bool stopped = false;
+
+    //Добавя двойката и връща номера ѝ
+    auto visit = [&](size_t i, size_t j)
+    {
+        std::pair<size_t, bool> inserted = index.insert(i, j);
+        if (inserted.second)
+        {
+            bool isFinal = accepting[i != sinkA && statesA[i]->isFinal][j != sinkB && statesB[j]->isFinal];
+            if (!onState(inserted.first, i, j, isFinal))
+            {
+                stopped = true;
+            }
+        }
+        return inserted.first;
+    };
 
-        State* stateA = current.first;
-        State* stateB = current.second;
-        State* currentState = stateMap[current];
+    visit(startA, startB);
+
+    //Номерата се дават в реда на откриване, затова обхождането по номера е обхождане в ширина
+    std::vector<int> cuts;
+    for (size_t current = 0; current < index.size() && !stopped; current++)
+    {
+        size_t i = index[current].first;
+        size_t j = index[current].second;
+        State* stateA = i != sinkA ? statesA[i] : nullptr;
+        State* stateB = j != sinkB ? statesB[j] : nullptr;
+
+        //Границите на интервалите от двете страни разделят символите на части, в които и двата прехода са еднакви
+        cuts.clear();
+        for (State* state : { stateA, stateB })
+        {
+            if (!state)
+            {
+                continue;
+            }
+            for (const TransitionRange& range : state->transitions)
+            {
+                cuts.push_back(range.low);
+                cuts.push_back(range.high + 1);
+            }
+        }
+        for (const SymbolRange& range : alphabet)
+        {
+            cuts.push_back(range.first);
+            cuts.push_back(range.second + 1);
+        }
+        std::sort(cuts.begin(), cuts.end());
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
 
-        //Добавяме преходи само за символите от общата азбука
-        for (char c : commonAlphabet)
+        for (size_t k = 0; k + 1 < cuts.size() && !stopped; k++)
         {
-            State* nextA = this->getNextState(stateA, c);
-            State* nextB = other.getNextState(stateB, c);
+            unsigned char low = static_cast<unsigned char>(cuts[k]);
+            unsigned char high = static_cast<unsigned char>(cuts[k + 1] - 1);
 
-            //Ако дори и в един от двата автомата няма преход с този символ, прескачаме
-            if (!nextA || !nextB)
+            const TransitionRange* rangeA = stateA ? stateA->findRange(low) : nullptr;
+            const TransitionRange* rangeB = stateB ? stateB->findRange(low) : nullptr;
+            if (!rangeA && !rangeB && !inAlphabet[low])
             {
                 continue;
             }
 
-            std::pair<State*, State*> nextPair(nextA, nextB);
+            size_t nextA = rangeA ? rangeA->destinations[0]->id : sinkA;
+            size_t nextB = rangeB ? rangeB->destinations[0]->id : sinkB;
+            if (isDead(nextA, nextB))
+            {
+                continue;
+            }
+            onTransition(current, low, high, visit(nextA, nextB));
+        }
+    }
 
-            //Ако двойката не е добавена в stateMap все още, създаваме ново състояние от нея и го правим
-            if (stateMap.find(nextPair) == stateMap.end())
+    return !stopped;
+}
+
+DFA DFA::product(const DFA& other, const std::function<bool(bool, bool)>& combine) const
+{
+    DFA result;
+    const std::vector<State*>& resultStates = result.getStates();
+
+    exploreProduct(other, combine,
+        [&](size_t, size_t i, size_t j, bool isFinal)
+        {
+            //Мъртвата страна не носи име, затова състоянието носи името на другата
+            if (i < getStateCount() && j < other.getStateCount())
             {
-                //Състояние в резултатния автомат е финално, само ако и двете състояния от двойката, която отговаря на него, са финални
-                bool nextIsFinal = nextA->isFinal && nextB->isFinal;
-                State* nextState = result->addState(nextA->name + "_" + nextB->name, nextIsFinal);
-                stateMap[nextPair] = nextState;
-                queue.push(nextPair);
+                result.addPairState(*this, getStates()[i], other, other.getStates()[j], isFinal);
             }
+            else if (i < getStateCount())
+            {
+                result.addDerivedState(*this, getStates()[i], isFinal);
+            }
+            else if (j < other.getStateCount())
+            {
+                result.addDerivedState(other, other.getStates()[j], isFinal);
+            }
+            else
+            {
+                result.addUnnamedState(isFinal);
+            }
+            return true;
+        },
+        [&](size_t from, unsigned char low, unsigned char high, size_t to)
+        {
+            //Частите идват подредени и не се застъпват, затова проверката на addRangeTransition не е нужна
+            resultStates[from]->addTransition(low, high, resultStates[to]);
+        });
 
-            result->addTransition(currentState, c, stateMap[nextPair]);
+    if (resultStates.empty())
+    {
+        return result;
+    }
+    result.setStartState(resultStates[0]);
+
+    for (const Automaton* source : { static_cast<const Automaton*>(this), static_cast<const Automaton*>(&other) })
+    {
+        for (char c : source->getAlphabet())
+        {
+            result.addSymbolToAlphabet(c);
         }
     }
 
+    //Двойките, от които не се достига финална двойка, не са нужни
+    result.trim();
+
     return result;
 }
 
-DFA* DFA::complement() const
+bool DFA::isProductEmpty(const DFA& other, const std::function<bool(bool, bool)>& combine) const
 {
-    //Правим финалните състояния нефинални, а нефиналните - финални
-    DFA* result = new DFA();
+    return exploreProduct(other, combine,
+        [](size_t, size_t, size_t, bool isFinal) { return !isFinal; },
+        [](size_t, unsigned char, unsigned char, size_t) {});
+}
 
-    std::unordered_map<State*, State*> stateMap;
+DFA DFA::unionWith(const DFA& other) const
+{
+    return product(other, [](bool inThis, bool inOther) { return inThis || inOther; });
+}
 
-    copyStates(*this, *result, stateMap, [](State* state, State* copied)
-        { copied->isFinal = !copied->isFinal; });
+DFA DFA::intersectWith(const DFA& other) const
+{
+    return product(other, [](bool inThis, bool inOther) { return inThis && inOther; });
+}
 
-    copyTransitions(*this, *result, stateMap);
+DFA DFA::differenceWith(const DFA& other) const
+{
+    return product(other, [](bool inThis, bool inOther) { return inThis && !inOther; });
+}
 
-    result->setStartState(stateMap[this->getStartState()]);
+DFA DFA::symmetricDifferenceWith(const DFA& other) const
+{
+    return product(other, [](bool inThis, bool inOther) { return inThis != inOther; });
+}
 
-    return result;
+bool DFA::isSubsetOf(const DFA& other) const
+{
+    return isProductEmpty(other, [](bool inThis, bool inOther) { return inThis && !inOther; });
 }
 
-std::string DFA::toRegex()const
+bool DFA::isEquivalentTo(const DFA& other) const
 {
-    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> transitions;
-    for (State* state : getStates())
+    return isProductEmpty(other, [](bool inThis, bool inOther) { return inThis != inOther; });
+}
+
+DFA DFA::complement() const&
+{
+    return DFA(*this).complement();
+}
+
+DFA DFA::complement() &&
+{
+    std::vector<SymbolRange> alphabet = alphabetRanges(getAlphabet());
+
+    //Символите от азбуката без преход водят в мъртво състояние, което след допълнението приема всичко
+    State* sink = nullptr;
+    auto getSink = [&]()
     {
-        for (const char& c : getAlphabet())
+        if (!sink)
         {
-            std::vector<State*> nextStates = getNextStates(state, c);
-            for (State* next : nextStates)
+            sink = addUnnamedState();
+            for (const SymbolRange& range : alphabet)
             {
-                // Добавяме прехода като регулярен израз
-                transitions[state->name][next->name] += transitions[state->name][next->name].empty() ? std::string(1, c) : "+" + c;
+                sink->addTransition(range.first, range.second, sink);
             }
         }
-    }
+        return sink;
+    };
 
-    // Запазваме състоянията, които не са финални и не са началното
-    std::set<std::string> intermediateStates;
-    for (State* state : getStates())
+    if (!getStartState())
     {
-        if (state != getStartState() && !state->isFinal)
-        {
-            intermediateStates.insert(state->name);
-        }
+        setStartState(getSink());
     }
 
-    // Премахваме междинните състояния
-    for (const std::string& inter : intermediateStates)
+    const std::vector<State*>& states = getStates();
+    for (size_t i = 0, count = states.size(); i < count; i++)
     {
-        for (State* pred : getStates())
+        State* state = states[i];
+        if (state == sink)
+        {
+            continue;
+        }
+        //Празните места в азбуката между съществуващите преходи. Събират се отделно, защото добавянето променя state->transitions
+        std::vector<SymbolRange> gaps;
+        for (const SymbolRange& range : alphabet)
         {
-            if (transitions[pred->name].count(inter))
+            int next = range.first;
+            for (const TransitionRange& transition : state->transitions)
             {
-                for (State* succ : getStates())
+                if (transition.high < next || transition.low > range.second)
                 {
-                    if (transitions[inter].count(succ->name))
-                    {
-                        // Ако съществува цикъл го описваме
-                        std::string loop = transitions[inter][inter].empty() ? "" : "(" + transitions[inter][inter] + ")*";
-                        
-                        // Конструираме нов преход от предходния до следващия
-                        std::string newTransition = "(" + transitions[pred->name][inter] + ")" + loop + "(" + transitions[inter][succ->name] + ")";
-
-                        // Добавяме новия преход към map-а и ако съществува минал преход ги комбинираме
-                        transitions[pred->name][succ->name] += transitions[pred->name][succ->name].empty() ? newTransition : "+" + newTransition;
-                    }
+                    continue;
+                }
+                if (transition.low > next)
+                {
+                    gaps.push_back({ static_cast<unsigned char>(next), static_cast<unsigned char>(transition.low - 1) });
                 }
+                next = transition.high + 1;
+            }
+            if (next <= range.second)
+            {
+                gaps.push_back({ static_cast<unsigned char>(next), range.second });
             }
         }
+        for (const SymbolRange& gap : gaps)
+        {
+            state->addTransition(gap.first, gap.second, getSink());
+        }
+    }
+
+    //Правим финалните състояния нефинални, а нефиналните - финални
+    for (State* state : getStates())
+    {
+        state->isFinal = !state->isFinal;
+    }
 
-        //Премахваме преработения преход от map-а
-        transitions.erase(inter);
-        for (auto& entry : transitions)
+    //Бившите приемащи състояния за поглъщане стават мъртви. Премахват се, за да спира разпознаването при влизане в тях
+    trim();
+
+    return std::move(*this);
+}
+
+std::string DFA::toRegex()const
+{
+    if (!getStartState())
+    {
+        return "";
+    }
+
+    //Работим с индексите на състоянията. Добавяме ново начално (n) и ново финално (n + 1) състояние
+    const std::vector<State*>& states = getStates();
+    const size_t n = states.size();
+    const size_t newStart = n;
+    const size_t newFinal = n + 1;
+
+    //Участват само състоянията, които са достижими от началното и от които се достига финално
+    std::vector<bool> useful = getUsefulStates();
+    if (!useful[getStartState()->id])
+    {
+        return "";
+    }
+
+    RegexAST ast;
+
+    //outgoing[p][q] е изразът върху прехода p -> q, а incoming[q] пази предшествениците на q
+    std::vector<std::unordered_map<size_t, RegexAST::NodeId>> outgoing(n + 2);
+    std::vector<std::unordered_set<size_t>> incoming(n + 2);
+
+    auto addEdge = [&](size_t from, size_t to, RegexAST::NodeId expression)
+    {
+        auto it = outgoing[from].find(to);
+        if (it == outgoing[from].end())
+        {
+            outgoing[from].emplace(to, expression);
+            incoming[to].insert(from);
+        }
+        else
+        {
+            it->second = ast.unite(it->second, expression);
+        }
+    };
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!useful[i])
         {
-            entry.second.erase(inter);
+            continue;
+        }
+        for (const TransitionRange& range : states[i]->transitions)
+        {
+            size_t next = range.destinations[0]->id;
+            if (useful[next])
+            {
+                addEdge(i, next, ast.symbol(range.low, range.high));
+            }
+        }
+        if (states[i]->isFinal)
+        {
+            addEdge(i, newFinal, ast.epsilon());
         }
     }
+    addEdge(newStart, getStartState()->id, ast.epsilon());
 
-    // Ако има цикъл в началното състояние
-    std::string startLoop = transitions[getStartState()->name][getStartState()->name];
-    std::string regex;
+    //Цената на премахването на едно състояние е броят на новите преходи, които създава (входящи * изходящи без примките)
+    auto cost = [&](size_t q)
+    {
+        size_t loop = outgoing[q].count(q);
+        return (incoming[q].size() - loop) * (outgoing[q].size() - loop);
+    };
+
+    //Опашка с приоритет, от която винаги взимаме състоянието с най-малка цена. Остарелите записи се прескачат
+    using Candidate = std::pair<size_t, size_t>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> order;
+    std::vector<bool> eliminated(n, false);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (useful[i])
+        {
+            order.push({ cost(i), i });
+        }
+    }
 
-    //Обхождаме финалните състояния
-    for (State* finalState : getStates())
+    while (!order.empty())
     {
-        if (finalState->isFinal)
+        Candidate candidate = order.top();
+        order.pop();
+
+        size_t q = candidate.second;
+        if (eliminated[q] || candidate.first != cost(q))
+        {
+            continue;
+        }
+        eliminated[q] = true;
+
+        auto loopIt = outgoing[q].find(q);
+        RegexAST::NodeId loop = loopIt == outgoing[q].end() ? ast.epsilon() : ast.star(loopIt->second);
+        outgoing[q].erase(q);
+        incoming[q].erase(q);
+
+        //Заменяме всеки път p -> q -> r с преход p -> r
+        for (size_t p : incoming[q])
+        {
+            RegexAST::NodeId toQ = ast.concat(outgoing[p][q], loop);
+            outgoing[p].erase(q);
+
+            for (const auto& edge : outgoing[q])
+            {
+                addEdge(p, edge.first, ast.concat(toQ, edge.second));
+            }
+        }
+        for (const auto& edge : outgoing[q])
         {
-            // Взимаме регулярния израз от началното състояние до крайното състояние
-            std::string path = transitions[getStartState()->name][finalState->name];
-            
-            // Ако има цикъл, взимаме регулярния му израз
-            std::string finalLoop = transitions[finalState->name][finalState->name];
-            if (!path.empty())
+            incoming[edge.first].erase(q);
+        }
+
+        //Цената на съседите се е променила
+        std::unordered_set<size_t> neighbours(incoming[q].begin(), incoming[q].end());
+        for (const auto& edge : outgoing[q])
+        {
+            neighbours.insert(edge.first);
+        }
+        for (size_t neighbour : neighbours)
+        {
+            if (neighbour < n && !eliminated[neighbour])
             {
-                // Добавяме ги във финалния регулярен израз
-                regex += regex.empty() ? "" : "+";
-                regex += "(" + path + ")" + (finalLoop.empty() ? "" : "(" + finalLoop + ")*");
+                order.push({ cost(neighbour), neighbour });
             }
         }
+
+        outgoing[q].clear();
+        incoming[q].clear();
     }
-    return regex;
+
+    auto result = outgoing[newStart].find(newFinal);
+    return ast.toString(result == outgoing[newStart].end() ? ast.emptySet() : result->second);
 }
 
-DFA* DFA::minimize()const { //Линк към алгоритъма, на който е базиран метода: https://www.geeksforgeeks.org/minimization-of-dfa
+DFA DFA::minimize()const { //Линк към алгоритъма, на който е базиран метода: https://www.geeksforgeeks.org/minimization-of-dfa
+    if (!getStartState()) {
+        return DFA();
+    }
+
+    //Недостижимите и мъртвите състояния не участват. Началното остава винаги
+    std::vector<bool> useful = getUsefulStates();
+    useful[getStartState()->id] = true;
+
+    //Връща следващото състояние, ако е полезно
+    auto nextUsefulState = [this, &useful](State* state, char c) {
+        State* next = getNextState(state, c);
+        return next && useful[next->id] ? next : nullptr;
+    };
+
+    //Символите, които никой преход не различава, се обработват заедно
+    std::vector<SymbolRange> symbolClasses = getSymbolClasses();
+
+    // Най-много памет се заема при разделянето: всяко състояние е в старото и в новото разделяне и в групите с ключа си,
+    // а накрая и в stateMap. Отчитаме я наведнъж, преди да започнем
+    const size_t usefulCount = std::count(useful.begin(), useful.end(), true);
+    const size_t setEntryBytes = sizeof(State*) + 3 * sizeof(void*);
+    const size_t keyBytes = symbolClasses.size() * (std::to_string(usefulCount).size() + 1);
+    MemoryLimit::charge(usefulCount * (4 * setEntryBytes + sizeof(State*) + keyBytes));
+
     //Разделяме състоянията на финални и нефинални
     std::unordered_set<State*> finalStates;
     std::unordered_set<State*> nonFinalStates;
 
     for (State* state : this->getStates()) {
+        if (!useful[state->id]) {
+            continue;
+        }
         if (state->isFinal) {
             finalStates.insert(state);
         }
         else nonFinalStates.insert(state);
     }
-    
+
     // Първо имаме само 2 множества - финални и нефинални
-    std::vector<std::unordered_set<State*>> uniqueSetsOfStates = { finalStates, nonFinalStates };
+    std::vector<std::unordered_set<State*>> uniqueSetsOfStates;
+    for (const std::unordered_set<State*>& set : { finalStates, nonFinalStates }) {
+        if (!set.empty()) {
+            uniqueSetsOfStates.push_back(set);
+        }
+    }
 
     // Показва дали са спрели да възникват нови множества
     bool isStable = false;
@@ -240,8 +575,9 @@ DFA* DFA::minimize()const { //Линк към алгоритъма, на кой
             // Групираме състоянията, в зависимост от преходите им и от кое множество са
             for (State* state : set) {
                 std::string key;
-                for (char c : getAlphabet()) {
-                    State* nextState = getNextState(state, c);
+                for (const SymbolRange& symbolClass : symbolClasses) {
+                    char c = static_cast<char>(symbolClass.first);
+                    State* nextState = nextUsefulState(state, c);
                     if (nextState) {
                         for (size_t i = 0; i < uniqueSetsOfStates.size(); i++) {
                             if (uniqueSetsOfStates[i].count(nextState)) {
@@ -272,31 +608,41 @@ DFA* DFA::minimize()const { //Линк към алгоритъма, на кой
         uniqueSetsOfStates = newSets;
     }
 
-    DFA* result = new DFA();
+    DFA result;
     std::unordered_map<State*, State*> stateMap;
 
     // Създаваме състояние в резултатния автомат за всяка получила се група
     for (const std::unordered_set<State*>& set : uniqueSetsOfStates) {
         State* chosenOne = *set.begin();
-        State* newState = result->addState(chosenOne->name, chosenOne->isFinal);
+        State* newState = result.addDerivedState(*this, chosenOne, chosenOne->isFinal);
         for (State* state : set) {
             stateMap[state] = newState;
         }
     }
 
     for (State* state : getStates()) {
+        if (!useful[state->id]) {
+            continue;
+        }
         State* mapped = stateMap[state];
-        for (char c : getAlphabet()) {
-            State* nextState = getNextState(state, c);
+        for (const SymbolRange& symbolClass : symbolClasses) {
+            char c = static_cast<char>(symbolClass.first);
+            State* nextState = nextUsefulState(state, c);
             if (nextState) {
                 State* mappedNext = stateMap[nextState];
-                if (!mapped->hasTransition(c))
-                    result->addTransition(mapped, c, mappedNext);
+                if (!mapped->findRange(symbolClass.first))
+                    result.addRangeTransition(mapped, symbolClass.first, symbolClass.second, mappedNext);
             }
         }
     }
 
-    result->setStartState(stateMap[getStartState()]);
+    result.setStartState(stateMap[getStartState()]);
 
     return result;
+}
+
+DFA DFA::minimizeBrzozowski()const
+{
+    //Детерминизацията на обърнатия автомат дава автомат без недостижими състояния, а при второто обръщане - и без еквивалентни
+    return reverse().determinize().reverse().determinize();
 }
\ No newline at end of file
@@ -0,0 +1,176 @@
+﻿#include "DictionaryBuilder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+DictionaryBuilder::DictionaryBuilder()
+    : registry(0, NodeHash{ &nodes }, NodeEqual{ &nodes }), hasPrevious(false)
+{
+    path.push_back(newNode());
+}
+
+size_t DictionaryBuilder::NodeHash::operator()(uint32_t node) const
+{
+    const Node& n = (*nodes)[node];
+    size_t hash = n.isFinal ? 1 : 0;
+    for (const auto& edge : n.edges)
+    {
+        hash = (hash ^ edge.first) * 0x100000001b3ULL;
+        hash = (hash ^ edge.second) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool DictionaryBuilder::NodeEqual::operator()(uint32_t left, uint32_t right) const
+{
+    const Node& a = (*nodes)[left];
+    const Node& b = (*nodes)[right];
+    return a.isFinal == b.isFinal && a.edges == b.edges;
+}
+
+uint32_t DictionaryBuilder::newNode()
+{
+    if (!freeNodes.empty())
+    {
+        uint32_t node = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[node] = Node{ false, {} };
+        return node;
+    }
+    nodes.push_back(Node{ false, {} });
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void DictionaryBuilder::replaceOrRegister(size_t keep)
+{
+    //Отзад напред, за да са децата вече заменени, когато се търси родителят
+    while (path.size() > keep + 1)
+    {
+        uint32_t child = path.back();
+        path.pop_back();
+        uint32_t parent = path.back();
+
+        auto found = registry.find(child);
+        if (found != registry.end())
+        {
+            nodes[parent].edges.back().second = *found;
+            nodes[child].edges.clear();
+            nodes[child].edges.shrink_to_fit();
+            freeNodes.push_back(child);
+        }
+        else
+        {
+            registry.insert(child);
+        }
+    }
+}
+
+void DictionaryBuilder::add(const std::string& word)
+{
+    if (hasPrevious)
+    {
+        int order = std::char_traits<char>::compare(previous.data(), word.data(), std::min(previous.size(), word.size()));
+        //char_traits<char>::compare сравнява като unsigned char
+        if (order > 0 || (order == 0 && previous.size() > word.size()))
+        {
+            throw std::invalid_argument("Words must be added in lexicographic order.");
+        }
+        if (order == 0 && previous.size() == word.size())
+        {
+            return;
+        }
+    }
+
+    //Общият префикс с предишната дума остава непроменен, останалата част от пътя ѝ вече няма да се променя
+    size_t prefix = 0;
+    while (hasPrevious && prefix < previous.size() && prefix < word.size() && previous[prefix] == word[prefix])
+    {
+        prefix++;
+    }
+    replaceOrRegister(prefix);
+
+    for (size_t i = prefix; i < word.size(); i++)
+    {
+        uint32_t node = newNode();
+        nodes[path.back()].edges.push_back({ static_cast<unsigned char>(word[i]), node });
+        path.push_back(node);
+    }
+    nodes[path.back()].isFinal = true;
+
+    previous = word;
+    hasPrevious = true;
+}
+
+DFA DictionaryBuilder::build()
+{
+    replaceOrRegister(0);
+
+    //Номерираме достижимите от корена възли в реда на BFS
+    DFA result;
+    std::vector<uint32_t> stateOf(nodes.size(), UINT32_MAX);
+    std::vector<uint32_t> order;
+    order.reserve(registry.size() + 1);
+    uint32_t root = path[0];
+    stateOf[root] = 0;
+    order.push_back(root);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        for (const auto& edge : nodes[order[i]].edges)
+        {
+            if (stateOf[edge.second] == UINT32_MAX)
+            {
+                stateOf[edge.second] = static_cast<uint32_t>(order.size());
+                order.push_back(edge.second);
+            }
+        }
+    }
+
+    for (uint32_t node : order)
+    {
+        result.addUnnamedState(nodes[node].isFinal);
+    }
+    result.setStartState(result.getStates()[0]);
+
+    const std::vector<State*>& states = result.getStates();
+    std::vector<bool> used(256, false);
+    for (uint32_t node : order)
+    {
+        //Преходите са подредени по символ, затова State::addTransition само ги добавя в края или слива със съседния
+        State* state = states[stateOf[node]];
+        for (const auto& edge : nodes[node].edges)
+        {
+            state->addTransition(edge.first, edge.first, states[stateOf[edge.second]]);
+            used[edge.first] = true;
+        }
+    }
+    for (int c = 0; c < 256; c++)
+    {
+        if (used[c])
+        {
+            result.addSymbolToAlphabet(static_cast<char>(c));
+        }
+    }
+
+    nodes.clear();
+    freeNodes.clear();
+    registry.clear();
+    path.assign(1, newNode());
+    previous.clear();
+    hasPrevious = false;
+    return result;
+}
+
+DFA DictionaryBuilder::fromWords(std::vector<std::string> words)
+{
+    //Сортираме като unsigned char, за да съвпада с реда, който add очаква
+    std::sort(words.begin(), words.end(), [](const std::string& a, const std::string& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+            [](char x, char y) { return static_cast<unsigned char>(x) < static_cast<unsigned char>(y); });
+    });
+
+    DictionaryBuilder builder;
+    for (const std::string& word : words)
+    {
+        builder.add(word);
+    }
+    return builder.build();
+}
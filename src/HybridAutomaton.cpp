@@ -0,0 +1,266 @@
+﻿#include "HybridAutomaton.hpp"
+#include "MemoryLimit.hpp"
+#include <algorithm>
+
+HybridAutomaton::HybridAutomaton(const Automaton& automaton, size_t maxStates, size_t maxBytes)
+    : nfa(automaton.freeze()), complete(true), startState(NO_STATE)
+{
+    const CompiledAutomaton& a = *nfa;
+    const size_t classCount = a.getClassCount();
+    maxStates = std::max<size_t>(maxStates, 1);
+    subsetOffsets.push_back(0);
+
+    if (a.getStartState() == NO_STATE)
+    {
+        return;
+    }
+
+    SparseSet closure(a.getStateCount());
+    SparseSet next(a.getStateCount());
+    std::vector<uint32_t> stack;
+    size_t used = memoryUsage();
+
+    //Връща състоянието за текущото съдържание на set. Създава го, ако има място, иначе връща NOT_BUILT
+    auto stateFor = [&](const SparseSet& set) {
+        if (set.empty())
+        {
+            return NO_STATE;
+        }
+        uint64_t hash = hashSubset(set);
+        uint32_t found = findSubset(set, hash);
+        if (found != NO_STATE)
+        {
+            return found;
+        }
+
+        //Ред в таблицата, подмножеството, отместването, хешът, финалността и най-много четири места в subsetLookup
+        size_t bytes = classCount * sizeof(uint32_t) + set.size() * sizeof(uint32_t) + 5 * sizeof(uint32_t) + sizeof(uint64_t) + 1;
+        if (finals.size() == maxStates || (!finals.empty() && bytes > maxBytes - std::min(used, maxBytes)))
+        {
+            complete = false;
+            return NOT_BUILT;
+        }
+        MemoryLimit::charge(bytes);
+        used += bytes;
+
+        uint32_t state = static_cast<uint32_t>(finals.size());
+        finals.push_back(a.containsFinal(set) ? 1 : 0);
+        subsetStates.insert(subsetStates.end(), set.begin(), set.end());
+        subsetOffsets.push_back(static_cast<uint32_t>(subsetStates.size()));
+        subsetHashes.push_back(hash);
+        table.resize(table.size() + classCount, NO_STATE);
+        indexLastSubset();
+        return state;
+    };
+
+    a.addWithEpsilonClosure(closure, a.getStartState(), stack);
+    startState = stateFor(closure);
+
+    //Номерата се дават в реда на създаване, затова обхождането по тях е обхождане в ширина
+    for (uint32_t state = 0; state < finals.size(); state++)
+    {
+        closure.clear();
+        for (uint32_t i = subsetOffsets[state]; i < subsetOffsets[state + 1]; i++)
+        {
+            closure.insert(subsetStates[i]);
+        }
+        for (size_t cls = 1; cls < classCount; cls++)
+        {
+            a.step(closure, next, stack, static_cast<uint16_t>(cls));
+            //stateFor може да разшири table, затова индексът се пресмята след това
+            uint32_t target = stateFor(next);
+            table[state * classCount + cls] = target;
+        }
+    }
+
+    //Масивите растат с удвояване, а ограничението е за реалния размер
+    finals.shrink_to_fit();
+    table.shrink_to_fit();
+    subsetOffsets.shrink_to_fit();
+    subsetStates.shrink_to_fit();
+    subsetHashes.shrink_to_fit();
+}
+
+size_t HybridAutomaton::memoryUsage() const
+{
+    return sizeof(HybridAutomaton) + finals.capacity() + table.capacity() * sizeof(uint32_t)
+        + (subsetOffsets.capacity() + subsetStates.capacity() + subsetLookup.capacity()) * sizeof(uint32_t)
+        + subsetHashes.capacity() * sizeof(uint64_t);
+}
+
+uint64_t HybridAutomaton::hashSubset(const SparseSet& set)
+{
+    //Сума на разбърканите елементи (splitmix64), за да не зависи от реда на добавяне
+    uint64_t hash = 0;
+    for (size_t value : set)
+    {
+        uint64_t x = value + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        hash += x ^ (x >> 31);
+    }
+    return hash;
+}
+
+uint32_t HybridAutomaton::findSubset(const SparseSet& set, uint64_t hash) const
+{
+    if (subsetLookup.empty())
+    {
+        return NO_STATE;
+    }
+    const size_t mask = subsetLookup.size() - 1;
+    for (size_t slot = hash & mask; subsetLookup[slot] != NO_STATE; slot = (slot + 1) & mask)
+    {
+        uint32_t state = subsetLookup[slot];
+        uint32_t begin = subsetOffsets[state];
+        uint32_t end = subsetOffsets[state + 1];
+        if (subsetHashes[state] != hash || end - begin != set.size())
+        {
+            continue;
+        }
+        //Елементите са различни и броят им е равен, затова е достатъчно всички да са в set
+        bool equal = true;
+        for (uint32_t i = begin; i < end && equal; i++)
+        {
+            equal = set.contains(subsetStates[i]);
+        }
+        if (equal)
+        {
+            return state;
+        }
+    }
+    return NO_STATE;
+}
+
+void HybridAutomaton::indexLastSubset()
+{
+    if (2 * finals.size() > subsetLookup.size())
+    {
+        subsetLookup.assign(std::max<size_t>(16, 2 * subsetLookup.size()), NO_STATE);
+        for (uint32_t state = 0; state + 1 < finals.size(); state++)
+        {
+            size_t mask = subsetLookup.size() - 1;
+            size_t slot = subsetHashes[state] & mask;
+            while (subsetLookup[slot] != NO_STATE)
+            {
+                slot = (slot + 1) & mask;
+            }
+            subsetLookup[slot] = state;
+        }
+    }
+    const size_t mask = subsetLookup.size() - 1;
+    size_t slot = subsetHashes.back() & mask;
+    while (subsetLookup[slot] != NO_STATE)
+    {
+        slot = (slot + 1) & mask;
+    }
+    subsetLookup[slot] = static_cast<uint32_t>(finals.size() - 1);
+}
+
+bool HybridAutomaton::accepts(const std::string& input) const
+{
+    //this е жив през цялото извикване, затова Matcher получава указател, който не го притежава
+    Matcher matcher(std::shared_ptr<const HybridAutomaton>(std::shared_ptr<const HybridAutomaton>(), this));
+    return matcher.accepts(input);
+}
+
+HybridAutomaton::Matcher::Matcher(std::shared_ptr<const HybridAutomaton> automaton)
+    : automaton(std::move(automaton)), state(NO_STATE), simulating(false), sinceCheck(0),
+    current(this->automaton && !this->automaton->complete ? this->automaton->nfa->getStateCount() : 0),
+    next(this->automaton && !this->automaton->complete ? this->automaton->nfa->getStateCount() : 0)
+{
+    if (this->automaton && !this->automaton->complete)
+    {
+        stack.reserve(this->automaton->nfa->getStateCount());
+    }
+    reset();
+}
+
+void HybridAutomaton::Matcher::reset()
+{
+    state = automaton ? automaton->startState : NO_STATE;
+    simulating = false;
+}
+
+void HybridAutomaton::Matcher::feed(const char* data, size_t length)
+{
+    if (!automaton)
+    {
+        return;
+    }
+    const HybridAutomaton& h = *automaton;
+    const CompiledAutomaton& a = *h.nfa;
+    const size_t classCount = a.getClassCount();
+
+    size_t i = 0;
+    while (i < length)
+    {
+        if (!simulating)
+        {
+            for (; i < length && state != NO_STATE; i++)
+            {
+                uint16_t cls = a.getClass(static_cast<unsigned char>(data[i]));
+                uint32_t target = h.table[state * classCount + cls];
+                if (target == NOT_BUILT)
+                {
+                    //Продължаваме със симулация от подмножеството на текущото състояние
+                    current.clear();
+                    for (uint32_t k = h.subsetOffsets[state]; k < h.subsetOffsets[state + 1]; k++)
+                    {
+                        current.insert(h.subsetStates[k]);
+                    }
+                    simulating = true;
+                    sinceCheck = 0;
+                    break;
+                }
+                state = target;
+            }
+            if (!simulating)
+            {
+                return;
+            }
+        }
+
+        while (i < length && !current.empty())
+        {
+            a.step(current, next, stack, a.getClass(static_cast<unsigned char>(data[i++])));
+            std::swap(current, next);
+            if (++sinceCheck == SWITCH_CHECK_INTERVAL)
+            {
+                sinceCheck = 0;
+                uint32_t found = h.findSubset(current, hashSubset(current));
+                if (found != NO_STATE)
+                {
+                    state = found;
+                    simulating = false;
+                    break;
+                }
+            }
+        }
+        if (simulating)
+        {
+            return;
+        }
+    }
+}
+
+bool HybridAutomaton::Matcher::isAccepting() const
+{
+    if (simulating)
+    {
+        return automaton->nfa->containsFinal(current);
+    }
+    return state != NO_STATE && automaton && automaton->finals[state];
+}
+
+bool HybridAutomaton::Matcher::isDead() const
+{
+    return simulating ? current.empty() : state == NO_STATE;
+}
+
+bool HybridAutomaton::Matcher::accepts(const std::string& input)
+{
+    reset();
+    feed(input);
+    return isAccepting();
+}
@@ -0,0 +1,47 @@
+﻿#include "MemoryLimit.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+thread_local MemoryLimit* MemoryLimit::current = nullptr;
+
+MemoryLimitExceeded::MemoryLimitExceeded(size_t limit, size_t requested)
+    : std::runtime_error("Memory limit of " + std::to_string(limit) + " bytes exceeded (" + std::to_string(requested) + " requested)"),
+    limit(limit), requested(requested)
+{
+}
+
+MemoryLimit::MemoryLimit(size_t bytes) : limit(bytes), used(0), outer(current)
+{
+    current = this;
+}
+
+MemoryLimit::~MemoryLimit()
+{
+    current = outer;
+}
+
+size_t MemoryLimit::available()
+{
+    size_t result = SIZE_MAX;
+    for (MemoryLimit* scope = current; scope; scope = scope->outer)
+    {
+        result = std::min(result, scope->limit - scope->used);
+    }
+    return result;
+}
+
+void MemoryLimit::add(size_t bytes)
+{
+    for (MemoryLimit* scope = this; scope; scope = scope->outer)
+    {
+        if (bytes > scope->limit - scope->used)
+        {
+            throw MemoryLimitExceeded(scope->limit, scope->used + bytes);
+        }
+    }
+    for (MemoryLimit* scope = this; scope; scope = scope->outer)
+    {
+        scope->used += bytes;
+    }
+}
@@ -1,5 +1,9 @@
 ﻿#include "NFA.hpp"
+#include "BitParallelNFA.hpp"
+#include "MemoryLimit.hpp"
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <queue>
 
 void NFA::addTransition(State* source, char symbol, State* destination)
@@ -10,76 +14,104 @@ void NFA::addTransition(State* source, char symbol, State* destination)
     }
 
     source->addTransition(symbol, destination);
+    onChange();
 }
 
-std::unordered_set<State*> NFA::epsilonClosure(const std::unordered_set<State*>& states) const
+void NFA::addRangeTransition(State* source, unsigned char low, unsigned char high, State* destination)
 {
-    //Множество от състояния достижими с празни преходи
-    std::unordered_set<State*> closure(states);
-    std::stack<State*> stack;
+    addRangeToAlphabet(low, high);
+    source->addTransition(low, high, destination);
+    onChange();
+}
 
-    for (State* state : states)
+void NFA::addWithEpsilonClosure(SparseSet& set, State* state, std::vector<State*>& stack) const
+{
+    if (!set.insert(state->id))
     {
-        stack.push(state);
+        return;
     }
 
-    //DFS
+    //DFS по празните преходи. Стекът е заделен предварително, затова тук не се заделя памет
+    stack.push_back(state);
     while (!stack.empty())
     {
-        State* state = stack.top();
-        stack.pop();
+        State* current = stack.back();
+        stack.pop_back();
 
-        for (State* nextState : state->getTransitions('@'))
+        for (State* nextState : current->epsilonTransitions)
         {
-            //Ако състоянието не е вече в множеството, го добавяме
-            if (closure.find(nextState) == closure.end())
+            if (set.insert(nextState->id))
             {
-                closure.insert(nextState);
-                stack.push(nextState);
+                stack.push_back(nextState);
             }
         }
     }
-
-    return closure;
 }
 
-std::unordered_set<State*> NFA::getNextStatesWithEpsilon(const std::unordered_set<State*>& currentStates, char symbol) const
+bool NFA::accepts(const std::string& input) const
 {
-    std::unordered_set<State*> nextStates;
+    if (!getStartState())
+    {
+        return false;
+    }
 
-    for (State* state : currentStates)
+    if (getStateCount() <= BitParallelNFA::MAX_STATES)
     {
-        for (State* nextState : state->getTransitions(symbol))
+        //Ако две нишки строят едновременно, и двете получават верен резултат, а се запазва последният
+        std::shared_ptr<const BitParallelCache> cache = std::atomic_load(&bitParallel);
+        if (!cache)
         {
-            nextStates.insert(nextState);
+            try
+            {
+                cache = std::make_shared<const BitParallelCache>(BitParallelCache{ BitParallelNFA::fromNFA(*this) });
+                std::atomic_store(&bitParallel, cache);
+            }
+            catch (const MemoryLimitExceeded&)
+            {
+                //Таблиците не се побират в ограничението. Симулира се множеството от състояния, без да се запазва кеш
+            }
+        }
+        if (cache && cache->engine)
+        {
+            return cache->engine->accepts(input);
         }
     }
 
-    return epsilonClosure(nextStates);
-}
+    //Текущото и следващото множество от състояния се пазят като индекси в две предварително заделени множества
+    const std::vector<State*>& states = getStates();
+    SparseSet currentStates(states.size());
+    SparseSet nextStates(states.size());
+    std::vector<State*> stack;
+    stack.reserve(states.size());
 
-bool NFA::accepts(const std::string& input) const
-{
-    if (!getStartState())
-    {
-        return false;
-    }
-
-    std::unordered_set<State*> currentStates = { getStartState() };
-    currentStates = epsilonClosure(currentStates);
+    addWithEpsilonClosure(currentStates, getStartState(), stack);
 
     for (char symbol : input)
     {
-        currentStates = getNextStatesWithEpsilon(currentStates, symbol);
+        nextStates.clear();
+        for (size_t id : currentStates)
+        {
+            const TransitionRange* range = states[id]->findRange(static_cast<unsigned char>(symbol));
+            if (!range)
+            {
+                continue;
+            }
+            for (State* nextState : range->destinations)
+            {
+                addWithEpsilonClosure(nextStates, nextState, stack);
+            }
+        }
+
+        std::swap(currentStates, nextStates);
         if (currentStates.empty())
         {
             return false;
         }
     }
 
-    for (State* state : currentStates)
+    for (size_t id : currentStates)
     {
-        if (state->isFinal)
+        if (states[id]->isFinal)
         {
             return true;
         }
@@ -88,195 +120,283 @@ bool NFA::accepts(const std::string& input) const
     return false;
 }
 
-NFA* NFA::unionWith(const NFA& other) const
+NFA NFA::unionWith(const NFA& other) const&
 {
-    NFA* result = new NFA();
-
-    //Създаваме ново "общо" начално състояние
-    State* newStart = result->addState("newStart");
-    result->setStartState(newStart);
-
-    std::unordered_map<State*, State*> stateMap;
+    return NFA(*this).unionWith(NFA(other));
+}
 
-    copyStates(*this, *result, stateMap, [this, result, newStart](State* state, State* copied)
-        {
-            copied->name = copied->name + "_1";
-            if (state == this->getStartState())
-            {
-                result->addTransition(newStart, '@', copied); //Добавяме празен преход от общото начално състояние към началното на първия
-            } });
+NFA NFA::unionWith(NFA&& other) &&
+{
+    State* thisStart = getStartState();
+    State* otherStart = other.getStartState();
 
-            copyTransitions(*this, *result, stateMap);
+    absorbStates(std::move(other));
 
-            copyStates(other, *result, stateMap, [&other, result, newStart](State* state, State* copied)
-                {
-                    copied->name = copied->name + "_2";
-                    if (state == other.getStartState())
-                    {
-                        result->addTransition(newStart, '@', copied);
-                    } });
+    //Създаваме ново "общо" начално състояние с празни преходи към началните на двата автомата
+    State* newStart = addUnnamedState();
+    setStartState(newStart);
+    if (thisStart)
+    {
+        addTransition(newStart, '@', thisStart);
+    }
+    if (otherStart)
+    {
+        addTransition(newStart, '@', otherStart);
+    }
 
-                    copyTransitions(other, *result, stateMap);
+    return std::move(*this);
+}
 
-                    return result;
+NFA NFA::concatWith(const NFA& other) const&
+{
+    return NFA(*this).concatWith(NFA(other));
 }
 
-NFA* NFA::concatWith(const NFA& other) const 
+NFA NFA::concatWith(NFA&& other) &&
 {
-    NFA* result = new NFA();
+    State* otherStart = other.getStartState();
 
+    //Финалните състояния на първия вече не са финални, а от тях има празен преход към началното на втория
     std::vector<State*> thisFinalStates;
-    State* otherStartState = nullptr;
-
-    std::unordered_map<State*, State*> stateMap;
+    for (State* state : getStates())
+    {
+        if (state->isFinal)
+        {
+            thisFinalStates.push_back(state);
+            state->isFinal = false;
+        }
+    }
+    absorbStates(std::move(other));
 
-    copyStates(*this, *result, stateMap, [&thisFinalStates, result, this](State* state, State* copied)
+    if (otherStart)
+    {
+        for (State* state : thisFinalStates)
         {
-            //Копираме състоянията на първия автомат в резултатния автомат, като използваме ламбда израз да променим имената, да копираме началното състояние
-            //и да запазим финалните му състояния
+            addTransition(state, '@', otherStart);
+        }
+    }
 
-            copied->name = copied->name + "_1";
-            if (state->isFinal) {
-                thisFinalStates.push_back(copied); 
-                copied->isFinal = false; //финалните състояния на първия вече не са финални
-            }
+    return std::move(*this);
+}
 
-            if (state == getStartState())
-            {
-                result->setStartState(copied);
-            } });
+NFA NFA::kleeneStar() const&
+{
+    return NFA(*this).kleeneStar();
+}
 
-            copyTransitions(*this, *result, stateMap);
+NFA NFA::kleeneStar() &&
+{
+    State* oldStart = getStartState();
+    std::vector<State*> finalStates;
+    for (State* state : getStates())
+    {
+        if (state->isFinal)
+        {
+            finalStates.push_back(state);
+        }
+    }
 
-            copyStates(other, *result, stateMap, [&otherStartState, result, &other](State* state, State* copied)
-            {
-                    //Копираме състоянията на втория автомат в резултатния автомат, като използваме ламбда израз да променим имената им и да запазим началното състояние
+    //Ново начално състояние. Старото може да е достижимо отново от вътрешни цикли, затова празната дума се разпознава само от новото
+    State* newStart = addUnnamedState();
+    setStartState(newStart);
 
-                    copied->name = copied->name + "_2";
-                    if (state == other.getStartState())
-                    {
-                        otherStartState = copied;
-                    } });
+    //Добавяме финално състояние достижимо с празен преход от началното. Това позволява разпознаване на празната дума от автомата
+    //Можем и просто да направим началното състояние финално, но този начин е по-верен към оригиналния алгоритъм
+    State* finalStart = addUnnamedState(true);
+    addTransition(newStart, '@', finalStart);
 
-            copyTransitions(other, *result, stateMap);
+    if (oldStart)
+    {
+        addTransition(newStart, '@', oldStart);
 
-            for (State* state : thisFinalStates) //Добавяме празен преход от всички бивши финални състояния на първия към началното на втория автомат
-            {
-                result->addTransition(state, '@', otherStartState);
-            }
+        //Добавяме празни преходи от финалните състояния към старото начално състояние.
+        for (State* state : finalStates)
+        {
+            addTransition(state, '@', oldStart);
+        }
+    }
 
-            return result;
+    return std::move(*this);
 }
 
-NFA* NFA::kleeneStar() const
-{
-    NFA* result = new NFA();
+NFA NFA::intersectWith(const NFA& other)const {
+    NFA result;
+    if (!getStartState() || !other.getStartState())
+    {
+        return result;
+    }
 
-    std::unordered_map<State*, State*> stateMap;
-    std::vector<State*> finalStates;
+    //Състоянията на резултата са двойки от състояния на двата автомата. Празен преход в единия автомат мести само неговата страна,
+    //а преход със символ - двете страни едновременно
+    const std::vector<State*>& statesA = getStates();
+    const std::vector<State*>& statesB = other.getStates();
+    const std::vector<State*>& resultStates = result.getStates();
+    PairIndex index(statesA.size(), statesB.size());
 
-    copyStates(*this, *result, stateMap, [&finalStates, this, &result](State* state, State* copied)
+    //Добавя двойката, ако я няма, и връща състоянието ѝ
+    auto visit = [&](State* stateA, State* stateB)
+    {
+        std::pair<size_t, bool> inserted = index.insert(stateA->id, stateB->id);
+        if (inserted.second)
         {
-            if (state->isFinal) {
-                finalStates.push_back(copied); //Запазваме финалните състояния
-            }
-            if (state == getStartState()) {
-                result->setStartState(copied); //Задаваме началното състояние
-            } });
+            //Състояние в резултатния автомат е финално, само ако и двете състояния от двойката, която отговаря на него, са финални
+            result.addPairState(*this, stateA, other, stateB, stateA->isFinal && stateB->isFinal);
+        }
+        return resultStates[inserted.first];
+    };
 
-            copyTransitions(*this, *result, stateMap);
+    result.setStartState(visit(getStartState(), other.getStartState()));
 
-            //Добавяме финално състояние достижимо с празен преход от началното. Това позволява разпознаване на празната дума от автомата
-            //Можем и просто да направим началното състояние финално, но този начин е по-верен към оригиналния алгоритъм
-            State* finalStart = result->addState("final-start", true);
-            result->addTransition(stateMap[getStartState()], '@', finalStart);
+    //Номерата на двойките са в реда на откриване, затова обхождаме в ширина по тях
+    for (size_t current = 0; current < index.size(); current++)
+    {
+        State* stateA = statesA[index[current].first];
+        State* stateB = statesB[index[current].second];
+        State* from = resultStates[current];
 
+        for (State* nextA : stateA->epsilonTransitions)
+        {
+            result.addTransition(from, '@', visit(nextA, stateB));
+        }
+        for (State* nextB : stateB->epsilonTransitions)
+        {
+            result.addTransition(from, '@', visit(stateA, nextB));
+        }
+
+        //Обхождаме едновременно подредените интервали на двете състояния. Преход има само за символите в сечението на два интервала
+        auto rangeA = stateA->transitions.begin();
+        auto rangeB = stateB->transitions.begin();
+        while (rangeA != stateA->transitions.end() && rangeB != stateB->transitions.end())
+        {
+            unsigned char low = std::max(rangeA->low, rangeB->low);
+            unsigned char high = std::min(rangeA->high, rangeB->high);
+
+            if (low <= high)
+            {
+                for (State* nextA : rangeA->destinations)
+                {
+                    for (State* nextB : rangeB->destinations)
+                    {
+                        result.addRangeTransition(from, low, high, visit(nextA, nextB));
+                    }
+                }
+            }
 
-            //Добавяме празни преходи от финалните състояния към началното състояние.
-            for (State* state : finalStates)
+            if (rangeA->high < rangeB->high)
+            {
+                ++rangeA;
+            }
+            else
             {
-                result->addTransition(state, '@', result->getStartState());
+                ++rangeB;
             }
+        }
+    }
+
+    //Двойките, от които не се достига финална двойка, не са нужни
+    result.trim();
 
-            return result;
+    return result;
 }
 
-NFA* NFA::intersectWith(const NFA& other)const { //Аналогично на реализацията за детерминиран автомат, само дето с всеки преход отиваме в множество от състояния
-    //Намираме обща азбука на двата автомата
-    std::unordered_set<char> commonAlphabet;
-    for (char symbol : getAlphabet())
+size_t NFA::cacheMemoryUsage() const
+{
+    std::shared_ptr<const BitParallelCache> cache = std::atomic_load(&bitParallel);
+    return cache && cache->engine ? cache->engine->memoryUsage() : 0;
+}
+
+DFA NFA::determinize() const
+{
+    DFA result;
+    if (!getStartState())
     {
-        if (other.getAlphabet().find(symbol) != other.getAlphabet().end())
-        {
-            commonAlphabet.insert(symbol);
-        }
+        return result;
     }
 
-    NFA* result = new NFA();
+    const std::vector<State*>& states = getStates();
+    std::vector<bool> useful = getUsefulStates();
+    std::vector<SymbolRange> symbolClasses = getSymbolClasses();
+
+    //Всяко състояние на резултата е подредено множество от индекси на полезни състояния, затворено по празните преходи.
+    //В него участват само състоянията с преходи със символ или финалните. Останалите не влияят на преходите и на финалността,
+    //а без тях множествата, които се различават само по тях, стават едно (например при началното състояние от reverse)
+    std::map<std::vector<size_t>, State*> subsetMap;
+    std::queue<std::vector<size_t>> queue;
+    const size_t SUBSET_ENTRY_BYTES = sizeof(decltype(subsetMap)::value_type) + 4 * sizeof(void*) + sizeof(std::vector<size_t>);
+    SparseSet closure(states.size());
+    std::vector<State*> stack;
+    stack.reserve(states.size());
+
+    //Връща състоянието на резултата за текущото съдържание на closure, като го създава, ако още го няма
+    auto subsetState = [&](bool isStart) {
+        std::vector<size_t> subset;
+        bool isFinal = false;
+        for (size_t id : closure)
+        {
+            if (useful[id] && (states[id]->isFinal || !states[id]->transitions.empty()))
+            {
+                subset.push_back(id);
+                isFinal = isFinal || states[id]->isFinal;
+            }
+        }
+        std::sort(subset.begin(), subset.end());
 
-    //Персонализирана хешираща функция
-    std::unordered_map<std::pair<State*, State*>, State*, PairHash> stateMap;
-    std::unordered_set<State*> thisStartClosure = epsilonClosure({ getStartState() });
-    std::unordered_set<State*> otherStartClosure = epsilonClosure({ other.getStartState() });
+        auto found = subsetMap.find(subset);
+        if (found != subsetMap.end())
+        {
+            return found->second;
+        }
+        if (subset.empty() && !isStart)
+        {
+            return static_cast<State*>(nullptr);
+        }
 
-    State* start = result->addState("start", false);
-    result->setStartState(start);
+        //Множеството се пази в subsetMap (с възела на дървото) и в опашката
+        MemoryLimit::charge(2 * subset.size() * sizeof(size_t) + SUBSET_ENTRY_BYTES);
+        State* state = result.addUnnamedState(isFinal);
+        subsetMap.emplace(subset, state);
+        queue.push(std::move(subset));
+        return state;
+    };
 
-    //Използваме BFS, за да построим резултатния автомат
-    std::queue<std::pair<std::unordered_set<State*>, std::unordered_set<State*>>> queue;
-    queue.push({ thisStartClosure, otherStartClosure });
-    stateMap[{*thisStartClosure.begin(), * otherStartClosure.begin()}] = start;
+    addWithEpsilonClosure(closure, getStartState(), stack);
+    result.setStartState(subsetState(true));
 
     while (!queue.empty())
     {
-        auto current = queue.front();
+        std::vector<size_t> subset = std::move(queue.front());
         queue.pop();
+        State* current = subsetMap[subset];
 
-        auto currentStatesA = current.first;
-        auto currentStatesB = current.second;
-
-        State* currentState = stateMap[{*currentStatesA.begin(), * currentStatesB.begin()}];
-
-        for (State* stateA : currentStatesA)
+        for (const SymbolRange& symbolClass : symbolClasses)
         {
-            for (State* stateB : currentStatesB)
+            closure.clear();
+            for (size_t id : subset)
             {
-                //Състояние в резултатния автомат е финално, само ако и двете състояния от двойката, която отговаря на него, са финални
-                if (stateA->isFinal && stateB->isFinal)
+                const TransitionRange* range = states[id]->findRange(symbolClass.first);
+                if (!range)
                 {
-                    currentState->isFinal = true;
+                    continue;
+                }
+                for (State* next : range->destinations)
+                {
+                    addWithEpsilonClosure(closure, next, stack);
                 }
-            }
-        }
-
-        //Добавяме преходи само за символите от общата азбука
-        for (char symbol : commonAlphabet)
-        {
-            std::unordered_set<State*> nextStatesA = getNextStatesWithEpsilon(currentStatesA, symbol);
-            std::unordered_set<State*> nextStatesB = other.getNextStatesWithEpsilon(currentStatesB, symbol);
-
-            //Ако дори и в един от двата автомата няма преход с този символ, прескачаме
-            if (nextStatesA.empty() || nextStatesB.empty())
-            {
-                continue;
             }
 
-            //Създаваме двойка за новите множества от състояния
-            std::pair<std::unordered_set<State*>, std::unordered_set<State*>> nextPair = std::make_pair(nextStatesA, nextStatesB);
-
-            //Ако двойката не е добавена в stateMap все още, създаваме ново състояние от нея и го правим
-            if (stateMap.find({ *nextStatesA.begin(), *nextStatesB.begin() }) == stateMap.end())
+            State* next = subsetState(false);
+            if (next)
             {
-                State* nextState = result->addState("state" + std::to_string(stateMap.size()), false);
-                stateMap[{*nextStatesA.begin(), * nextStatesB.begin()}] = nextState;
-                //Добавяме новата двойка в опашката
-                queue.push(nextPair);
+                result.addRangeTransition(current, symbolClass.first, symbolClass.second, next);
             }
-
-            //Добавяме преход от сегашното състояние към следващото в резултатния автомат
-            result->addTransition(currentState, symbol, stateMap[{*nextStatesA.begin(), * nextStatesB.begin()}]);
         }
     }
 
+    //Азбуката се запазва, за да може допълнението да се построи спрямо нея
+    for (char c : getAlphabet())
+    {
+        result.addSymbolToAlphabet(c);
+    }
+
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,310 @@
+﻿#include "RegexAST.hpp"
+#include <algorithm>
+
+RegexAST::RegexAST()
+{
+    intern({ NodeType::EmptySet, 0, 0, {}, false });
+    intern({ NodeType::Epsilon, 0, 0, {}, true });
+}
+
+size_t RegexAST::NodeHash::operator()(const Node& node) const
+{
+    size_t hash = (static_cast<size_t>(node.type) * 257 + node.low) * 257 + node.high;
+    for (NodeId child : node.children)
+    {
+        hash ^= child + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+bool RegexAST::NodeEqual::operator()(const Node& a, const Node& b) const
+{
+    return a.type == b.type && a.low == b.low && a.high == b.high && a.children == b.children;
+}
+
+RegexAST::NodeId RegexAST::intern(Node node)
+{
+    auto it = index.find(node);
+    if (it != index.end())
+    {
+        return it->second;
+    }
+
+    NodeId id = nodes.size();
+    nodes.push_back(node);
+    index.emplace(std::move(node), id);
+    return id;
+}
+
+void RegexAST::flatten(NodeType type, NodeId id, std::vector<NodeId>& children) const
+{
+    if (nodes[id].type == type)
+    {
+        children.insert(children.end(), nodes[id].children.begin(), nodes[id].children.end());
+    }
+    else
+    {
+        children.push_back(id);
+    }
+}
+
+RegexAST::NodeId RegexAST::symbol(char c)
+{
+    return symbol(static_cast<unsigned char>(c), static_cast<unsigned char>(c));
+}
+
+RegexAST::NodeId RegexAST::symbol(unsigned char low, unsigned char high)
+{
+    return intern({ NodeType::Symbol, low, high, {}, false });
+}
+
+RegexAST::NodeId RegexAST::unite(NodeId a, NodeId b)
+{
+    std::vector<NodeId> children;
+    flatten(NodeType::Union, a, children);
+    flatten(NodeType::Union, b, children);
+
+    //Премахваме празното множество и повтарящите се изрази
+    children.erase(std::remove(children.begin(), children.end(), EMPTY_SET), children.end());
+    std::sort(children.begin(), children.end());
+    children.erase(std::unique(children.begin(), children.end()), children.end());
+
+    //Сливаме символите със застъпващи се или съседни интервали: a + b = [a-b]
+    std::vector<NodeId> symbols;
+    for (NodeId child : children)
+    {
+        if (nodes[child].type == NodeType::Symbol)
+        {
+            symbols.push_back(child);
+        }
+    }
+    if (symbols.size() > 1)
+    {
+        std::sort(symbols.begin(), symbols.end(), [this](NodeId x, NodeId y) { return nodes[x].low < nodes[y].low; });
+
+        std::vector<NodeId> merged;
+        unsigned char low = nodes[symbols[0]].low;
+        unsigned char high = nodes[symbols[0]].high;
+        for (size_t i = 1; i <= symbols.size(); i++)
+        {
+            if (i < symbols.size() && nodes[symbols[i]].low <= high + 1)
+            {
+                high = std::max(high, nodes[symbols[i]].high);
+                continue;
+            }
+            merged.push_back(symbol(low, high));
+            if (i < symbols.size())
+            {
+                low = nodes[symbols[i]].low;
+                high = nodes[symbols[i]].high;
+            }
+        }
+
+        children.erase(std::remove_if(children.begin(), children.end(), [this](NodeId child)
+            { return nodes[child].type == NodeType::Symbol; }), children.end());
+        children.insert(children.end(), merged.begin(), merged.end());
+        std::sort(children.begin(), children.end());
+    }
+
+    //r + r* = r*
+    std::vector<NodeId> covered;
+    bool hasOtherNullable = false;
+    for (NodeId child : children)
+    {
+        if (nodes[child].type == NodeType::Star)
+        {
+            covered.push_back(nodes[child].children[0]);
+        }
+        if (child != EPSILON && nodes[child].nullable)
+        {
+            hasOtherNullable = true;
+        }
+    }
+    if (hasOtherNullable)
+    {
+        covered.push_back(EPSILON); //Празната дума вече се съдържа в друг подизраз
+    }
+    if (!covered.empty())
+    {
+        std::sort(covered.begin(), covered.end());
+        children.erase(std::remove_if(children.begin(), children.end(), [&covered](NodeId child)
+            { return std::binary_search(covered.begin(), covered.end(), child); }), children.end());
+    }
+
+    if (children.empty())
+    {
+        return EMPTY_SET;
+    }
+    if (children.size() == 1)
+    {
+        return children[0];
+    }
+
+    bool nullable = false;
+    for (NodeId child : children)
+    {
+        nullable = nullable || nodes[child].nullable;
+    }
+    return intern({ NodeType::Union, 0, 0, std::move(children), nullable });
+}
+
+RegexAST::NodeId RegexAST::concat(NodeId a, NodeId b)
+{
+    if (a == EMPTY_SET || b == EMPTY_SET)
+    {
+        return EMPTY_SET;
+    }
+
+    std::vector<NodeId> children;
+    flatten(NodeType::Concat, a, children);
+    flatten(NodeType::Concat, b, children);
+
+    std::vector<NodeId> simplified;
+    for (NodeId child : children)
+    {
+        if (child == EPSILON)
+        {
+            continue;
+        }
+        //r*r* = r*
+        if (!simplified.empty() && simplified.back() == child && nodes[child].type == NodeType::Star)
+        {
+            continue;
+        }
+        simplified.push_back(child);
+    }
+
+    if (simplified.empty())
+    {
+        return EPSILON;
+    }
+    if (simplified.size() == 1)
+    {
+        return simplified[0];
+    }
+
+    bool nullable = true;
+    for (NodeId child : simplified)
+    {
+        nullable = nullable && nodes[child].nullable;
+    }
+    return intern({ NodeType::Concat, 0, 0, std::move(simplified), nullable });
+}
+
+RegexAST::NodeId RegexAST::star(NodeId a)
+{
+    if (a == EMPTY_SET || a == EPSILON || nodes[a].type == NodeType::Star)
+    {
+        return a == EMPTY_SET ? EPSILON : a;
+    }
+
+    //(@ + r + s*)* = (r + s)*
+    if (nodes[a].type == NodeType::Union)
+    {
+        NodeId inner = EMPTY_SET;
+        for (NodeId child : nodes[a].children)
+        {
+            if (child == EPSILON)
+            {
+                continue;
+            }
+            inner = unite(inner, nodes[child].type == NodeType::Star ? nodes[child].children[0] : child);
+        }
+        if (inner != a)
+        {
+            return star(inner);
+        }
+    }
+
+    return intern({ NodeType::Star, 0, 0, { a }, true });
+}
+
+int RegexAST::priority(NodeId id) const
+{
+    switch (nodes[id].type)
+    {
+    case NodeType::Union:
+        return 1;
+    case NodeType::Concat:
+        return 2;
+    case NodeType::Star:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+std::string RegexAST::toString(NodeId root) const
+{
+    std::string result;
+    if (root != EMPTY_SET)
+    {
+        write(root, result);
+    }
+    return result;
+}
+
+void RegexAST::write(NodeId id, std::string& result) const
+{
+    const Node& node = nodes[id];
+
+    //Слага скоби около подизраз, ако приоритетът му е по-нисък от този на родителя
+    auto writeChild = [this, &result](NodeId child, int parentPriority)
+    {
+        bool needsBrackets = priority(child) < parentPriority;
+        if (needsBrackets)
+        {
+            result += '(';
+        }
+        write(child, result);
+        if (needsBrackets)
+        {
+            result += ')';
+        }
+    };
+
+    switch (node.type)
+    {
+    case NodeType::EmptySet:
+        break;
+    case NodeType::Epsilon:
+        result += '@';
+        break;
+    case NodeType::Symbol:
+        if (node.low == node.high)
+        {
+            result += static_cast<char>(node.low);
+        }
+        else if (node.low == 32 && node.high == 126)
+        {
+            result += '?';
+        }
+        else
+        {
+            result += '[';
+            result += static_cast<char>(node.low);
+            result += '-';
+            result += static_cast<char>(node.high);
+            result += ']';
+        }
+        break;
+    case NodeType::Union:
+    case NodeType::Concat:
+    {
+        char separator = node.type == NodeType::Union ? '+' : '.';
+        for (size_t i = 0; i < node.children.size(); i++)
+        {
+            if (i > 0)
+            {
+                result += separator;
+            }
+            writeChild(node.children[i], priority(id));
+        }
+        break;
+    }
+    case NodeType::Star:
+        writeChild(node.children[0], 4);
+        result += '*';
+        break;
+    }
+}
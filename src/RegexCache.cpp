@@ -0,0 +1,107 @@
+﻿#include "RegexCache.hpp"
+#include "RegexToNFA.hpp"
+
+RegexCache::RegexCache(size_t byteBudget, Compiler compiler)
+    : byteBudget(byteBudget), compiler(compiler ? std::move(compiler) : Compiler(compileMinimal)),
+    bytes(0), hits(0), misses(0), evictions(0)
+{
+}
+
+std::shared_ptr<const CompiledAutomaton> RegexCache::compileMinimal(const std::string& regex)
+{
+    return RegexToNFA::fromRegex(regex).determinize().minimize().freeze();
+}
+
+std::shared_ptr<const CompiledAutomaton> RegexCache::get(const std::string& regex)
+{
+    std::promise<std::shared_ptr<const CompiledAutomaton>> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto found = index.find(regex);
+        if (found != index.end())
+        {
+            hits++;
+            entries.splice(entries.begin(), entries, found->second);
+            std::shared_future<std::shared_ptr<const CompiledAutomaton>> automaton = found->second->automaton;
+
+            //Ако някой друг още компилира израза, чакаме без заключване
+            lock.unlock();
+            return automaton.get();
+        }
+
+        misses++;
+        entries.push_front({ regex, promise.get_future().share(), 0, false });
+        index.emplace(regex, entries.begin());
+    }
+
+    std::shared_ptr<const CompiledAutomaton> automaton;
+    try
+    {
+        automaton = compiler(regex);
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(regex);
+        if (found != index.end() && !found->second->ready)
+        {
+            entries.erase(found->second);
+            index.erase(found);
+        }
+        throw;
+    }
+    promise.set_value(automaton);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(regex);
+    if (found != index.end() && !found->second->ready)
+    {
+        found->second->ready = true;
+        found->second->bytes = automaton ? automaton->memoryUsage() : 0;
+        bytes += found->second->bytes;
+        evict();
+    }
+    return automaton;
+}
+
+RegexCache::Statistics RegexCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return { hits, misses, evictions, entries.size(), bytes };
+}
+
+void RegexCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->ready)
+        {
+            bytes -= entry->bytes;
+            index.erase(entry->regex);
+            entry = entries.erase(entry);
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+}
+
+void RegexCache::evict()
+{
+    auto entry = entries.end();
+    while (bytes > byteBudget && entry != entries.begin())
+    {
+        --entry;
+        if (!entry->ready)
+        {
+            continue;
+        }
+        bytes -= entry->bytes;
+        index.erase(entry->regex);
+        entry = entries.erase(entry);
+        evictions++;
+    }
+}
@@ -0,0 +1,172 @@
+﻿#include "RegexDiskCache.hpp"
+#include "ArchiveFormat.hpp"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char CACHE_MAGIC[4] = { 'F', 'R', 'C', 'H' };
+
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+
+    //FNV-1a върху байтовете на низа, започвайки от seed
+    uint64_t fnv1a(const std::string& text, uint64_t seed)
+    {
+        uint64_t hash = seed;
+        for (char c : text)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    void writeString(std::ostream& out, const std::string& text)
+    {
+        ArchiveWriter::writeRawVarint(out, text.size());
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    //Чете низ, записан с writeString, но само ако е с дължина expected. Иначе файлът не е за търсения израз
+    bool readExpectedString(std::istream& in, const std::string& expected)
+    {
+        if (ArchiveReader::readRawVarint(in) != expected.size())
+        {
+            return false;
+        }
+        std::string text(expected.size(), '\0');
+        return in.read(&text[0], static_cast<std::streamsize>(text.size())) && text == expected;
+    }
+}
+
+RegexDiskCache::RegexDiskCache(std::string directory, std::string options, RegexCache::Compiler compiler)
+    : directory(std::move(directory)), options(std::move(options)),
+    compiler(compiler ? std::move(compiler) : RegexCache::Compiler(RegexCache::compileMinimal)),
+    loads(0), compilations(0), rejected(0), temporaryCounter(0)
+{
+}
+
+std::string RegexDiskCache::pathFor(const std::string& regex) const
+{
+    //Ключът съдържа дължините, за да не съвпадат различни двойки (израз, настройки) с еднакво слепване
+    std::string key = std::to_string(CACHE_VERSION) + ":" + std::to_string(options.size()) + ":" + options
+        + std::to_string(regex.size()) + ":" + regex;
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx%016llx.faut",
+        static_cast<unsigned long long>(fnv1a(key, FNV_OFFSET_BASIS)),
+        static_cast<unsigned long long>(fnv1a(key, 0x84222325cbf29ce4ULL)));
+
+    if (directory.empty())
+    {
+        return name;
+    }
+    char last = directory.back();
+    return directory + (last == '/' || last == '\\' ? "" : "/") + name;
+}
+
+std::shared_ptr<const CompiledAutomaton> RegexDiskCache::get(const std::string& regex)
+{
+    std::string path = pathFor(regex);
+    std::shared_ptr<const CompiledAutomaton> automaton = tryLoad(path, regex);
+    if (automaton)
+    {
+        loads++;
+        return automaton;
+    }
+
+    automaton = compiler(regex);
+    compilations++;
+    if (automaton)
+    {
+        store(path, regex, *automaton);
+    }
+    return automaton;
+}
+
+std::shared_ptr<const CompiledAutomaton> RegexDiskCache::tryLoad(const std::string& path, const std::string& regex)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        char magic[4];
+        if (file.read(magic, 4) && std::equal(magic, magic + 4, CACHE_MAGIC)
+            && ArchiveReader::readRawVarint(file) == CACHE_VERSION
+            && readExpectedString(file, options) && readExpectedString(file, regex))
+        {
+            //Автоматът се чете, само ако хешът на всичко след заглавието съвпада
+            uint64_t checksum = ArchiveReader::readRawVarint(file);
+            std::string payload((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (fnv1a(payload, FNV_OFFSET_BASIS) == checksum)
+            {
+                std::istringstream in(payload);
+                std::shared_ptr<const CompiledAutomaton> automaton = CompiledAutomaton::load(in);
+                //След автомата не трябва да има нищо
+                if (in.peek() == std::char_traits<char>::eof())
+                {
+                    return automaton;
+                }
+            }
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+
+    rejected++;
+    return nullptr;
+}
+
+void RegexDiskCache::store(const std::string& path, const std::string& regex, const CompiledAutomaton& automaton)
+{
+#ifdef _WIN32
+    const long processId = static_cast<long>(_getpid());
+#else
+    const long processId = static_cast<long>(getpid());
+#endif
+
+    //Уникално временно име за всеки процес и нишка, за да не пишат два процеса или две нишки в един файл
+    std::string temporary = path + "." + std::to_string(processId) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))
+        + "." + std::to_string(temporaryCounter++) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return;
+        }
+        file.write(CACHE_MAGIC, 4);
+        ArchiveWriter::writeRawVarint(file, CACHE_VERSION);
+        writeString(file, options);
+        writeString(file, regex);
+        std::ostringstream payload;
+        automaton.save(payload);
+        std::string bytes = payload.str();
+        ArchiveWriter::writeRawVarint(file, fnv1a(bytes, FNV_OFFSET_BASIS));
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!file.flush())
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+
+    //rename замества съществуващия файл наведнъж. В Windows не замества и тогава оставяме наличния, който е за същия израз
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+    }
+}
@@ -1,4 +1,5 @@
 ﻿#include "RegexToNFA.hpp"
+#include <algorithm>
 
 
 bool RegexToNFA::isOperator(char c)
@@ -30,9 +31,21 @@ std::string RegexToNFA::toPostfix(const std::string& regex)
     std::string postfix;
     std::stack<char> operatorStack;
 
-    for (char c : regex)
+    for (size_t i = 0; i < regex.size(); i++)
     {
-        if (c == '(')
+        char c = regex[i];
+        if (c == '[')
+        {
+            //Класът от символи е един операнд - копираме го целия
+            size_t end = regex.find(']', i + 1);
+            if (end == std::string::npos)
+            {
+                throw std::invalid_argument("Unterminated character class.");
+            }
+            postfix += regex.substr(i, end - i + 1);
+            i = end;
+        }
+        else if (c == '(')
         {
             operatorStack.push(c);
         }
@@ -43,6 +56,10 @@ std::string RegexToNFA::toPostfix(const std::string& regex)
                 postfix += operatorStack.top();
                 operatorStack.pop();
             }
+            if (operatorStack.empty())
+            {
+                throw std::invalid_argument("Unbalanced parentheses.");
+            }
             operatorStack.pop();
         }
         else if (isOperator(c))
@@ -62,6 +79,10 @@ std::string RegexToNFA::toPostfix(const std::string& regex)
 
     while (!operatorStack.empty())
     {
+        if (operatorStack.top() == '(')
+        {
+            throw std::invalid_argument("Unbalanced parentheses.");
+        }
         postfix += operatorStack.top();
         operatorStack.pop();
     }
@@ -69,80 +90,125 @@ std::string RegexToNFA::toPostfix(const std::string& regex)
     return postfix;
 }
 
-NFA* RegexToNFA::handleChar(char c)
+NFA RegexToNFA::handleChar(char c)
 {
-    NFA* nfa = new NFA();
-    State* start = nfa->addState("start");
-    State* end = nfa->addState("end", true);
-    nfa->setStartState(start);
+    NFA nfa;
+    State* start = nfa.addUnnamedState();
+    State* end = nfa.addUnnamedState(true);
+    nfa.setStartState(start);
 
-    //Добавя преход с произволен символ
+    //Добавя преход с произволен видим символ като едно ребро
     if (c == '?')
     {
-        for (char symbol = 32; symbol < 127; ++symbol)
-        {
-            nfa->addTransition(start, symbol, end);
-        }
+        nfa.addRangeTransition(start, 32, 126, end);
     }
     else {
-        nfa->addTransition(start, c, end);
+        nfa.addTransition(start, c, end);
     }
 
     return nfa;
 }
 
-NFA* RegexToNFA::handleOperator(char operation, std::stack<NFA*>& stack)
+NFA RegexToNFA::handleClass(const std::string& body)
+{
+    NFA nfa;
+    State* start = nfa.addUnnamedState();
+    State* end = nfa.addUnnamedState(true);
+    nfa.setStartState(start);
+
+    for (const SymbolRange& range : parseClass(body))
+    {
+        nfa.addRangeTransition(start, range.first, range.second, end);
+    }
+
+    return nfa;
+}
+
+std::vector<SymbolRange> RegexToNFA::parseClass(const std::string& body)
+{
+    std::vector<SymbolRange> ranges;
+
+    //Всеки елемент на класа е или символ, или интервал от вида a-z
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        unsigned char low = static_cast<unsigned char>(body[i]);
+        unsigned char high = low;
+        if (i + 2 < body.size() && body[i + 1] == '-')
+        {
+            high = static_cast<unsigned char>(body[i + 2]);
+            i += 2;
+        }
+        if (low > high)
+        {
+            throw std::invalid_argument("Invalid range in character class.");
+        }
+        ranges.push_back({ low, high });
+    }
+
+    return ranges;
+}
+
+NFA RegexToNFA::popOperand(std::stack<NFA>& stack)
+{
+    if (stack.empty())
+    {
+        throw std::invalid_argument("Invalid regular expression.");
+    }
+    NFA top = std::move(stack.top());
+    stack.pop();
+    return top;
+}
+
+NFA RegexToNFA::handleOperator(char operation, std::stack<NFA>& stack)
 {
     switch (operation)
     {
     //Звезда на Клини
     case '*':
     {
-        NFA* top = stack.top();
-        stack.pop();
-        return top->kleeneStar();
+        return popOperand(stack).kleeneStar();
     }
     //Обединение
     case '+':
     {
-        NFA* right = stack.top();
-        stack.pop();
-        NFA* left = stack.top();
-        stack.pop();
-        return left->unionWith(*right);
+        NFA right = popOperand(stack);
+        NFA left = popOperand(stack);
+        return std::move(left).unionWith(std::move(right));
     }
     //Сечение
     case '&':
     {
-        NFA* right = stack.top();
-        stack.pop();
-        NFA* left = stack.top();
-        stack.pop();
-        return left->intersectWith(*right);
+        NFA right = popOperand(stack);
+        NFA left = popOperand(stack);
+        return left.intersectWith(right);
     }
     //Конкатенация
     case '.':
     {
-        NFA* right = stack.top();
-        stack.pop();
-        NFA* left = stack.top();
-        stack.pop();
-        return left->concatWith(*right);
+        NFA right = popOperand(stack);
+        NFA left = popOperand(stack);
+        return std::move(left).concatWith(std::move(right));
     }
     default:
-        return nullptr;
+        throw std::invalid_argument("Invalid regular expression.");
     }
 }
 
-NFA* RegexToNFA::fromRegex(const std::string& regex)
+NFA RegexToNFA::fromRegex(const std::string& regex)
 {
     std::string postfix = toPostfix(regex);
-    std::cout << "Postfix expression: " << postfix << std::endl;
-    std::stack<NFA*> stack;
+    std::stack<NFA> stack;
 
-    for (char c : postfix)
+    for (size_t i = 0; i < postfix.size(); i++)
     {
-        if (isOperator(c))
+        char c = postfix[i];
+        if (c == '[')
+        {
+            size_t end = postfix.find(']', i + 1);
+            stack.push(handleClass(postfix.substr(i + 1, end - i - 1)));
+            i = end;
+        }
+        else if (isOperator(c))
         {
             stack.push(handleOperator(c, stack));
         }
@@ -152,5 +218,159 @@ NFA* RegexToNFA::fromRegex(const std::string& regex)
         }
     }
 
-    return stack.top();
-}
\ No newline at end of file
+    NFA result = popOperand(stack);
+    if (!stack.empty())
+    {
+        throw std::invalid_argument("Invalid regular expression.");
+    }
+    return result;
+}
+
+NFA RegexToNFA::fromRegexGlushkov(const std::string& regex)
+{
+    std::string postfix = toPostfix(regex);
+
+    //Етикетите на позициите. Позиция i в израза става състояние i + 1 в автомата
+    std::vector<std::vector<SymbolRange>> labels;
+    std::vector<std::vector<size_t>> follow;
+    std::stack<GlushkovSets> stack;
+
+    auto newPosition = [&labels, &follow, &stack](std::vector<SymbolRange> label)
+    {
+        size_t position = labels.size();
+        labels.push_back(std::move(label));
+        follow.emplace_back();
+        stack.push({ false, { position }, { position } });
+    };
+
+    //Извиква се при конкатенация и звезда: всяка позиция от from може да бъде последвана от всяка позиция от to
+    auto addFollow = [&follow](const std::vector<size_t>& from, const std::vector<size_t>& to)
+    {
+        for (size_t position : from)
+        {
+            follow[position].insert(follow[position].end(), to.begin(), to.end());
+        }
+    };
+
+    auto popOperand = [&stack]()
+    {
+        if (stack.empty())
+        {
+            throw std::invalid_argument("Invalid regular expression.");
+        }
+        GlushkovSets top = std::move(stack.top());
+        stack.pop();
+        return top;
+    };
+
+    for (size_t i = 0; i < postfix.size(); i++)
+    {
+        char c = postfix[i];
+        if (c == '[')
+        {
+            size_t end = postfix.find(']', i + 1);
+            newPosition(parseClass(postfix.substr(i + 1, end - i - 1)));
+            i = end;
+        }
+        else if (c == '?')
+        {
+            newPosition({ { 32, 126 } });
+        }
+        else if (c == '@')
+        {
+            stack.push({ true, {}, {} });
+        }
+        else if (c == '*')
+        {
+            GlushkovSets operand = popOperand();
+            addFollow(operand.last, operand.first);
+            operand.nullable = true;
+            stack.push(std::move(operand));
+        }
+        else if (c == '.' || c == '+')
+        {
+            GlushkovSets right = popOperand();
+            GlushkovSets left = popOperand();
+            GlushkovSets result;
+
+            if (c == '.')
+            {
+                addFollow(left.last, right.first);
+                result.nullable = left.nullable && right.nullable;
+                result.first = left.first;
+                if (left.nullable)
+                {
+                    result.first.insert(result.first.end(), right.first.begin(), right.first.end());
+                }
+                result.last = right.last;
+                if (right.nullable)
+                {
+                    result.last.insert(result.last.end(), left.last.begin(), left.last.end());
+                }
+            }
+            else
+            {
+                result.nullable = left.nullable || right.nullable;
+                result.first = left.first;
+                result.first.insert(result.first.end(), right.first.begin(), right.first.end());
+                result.last = left.last;
+                result.last.insert(result.last.end(), right.last.begin(), right.last.end());
+            }
+            stack.push(std::move(result));
+        }
+        else if (c == '&')
+        {
+            //Сечението не може да се изрази с позиции
+            throw std::invalid_argument("Intersection is not supported by the Glushkov construction.");
+        }
+        else
+        {
+            unsigned char symbol = static_cast<unsigned char>(c);
+            newPosition({ { symbol, symbol } });
+        }
+    }
+
+    GlushkovSets expression = popOperand();
+    if (!stack.empty())
+    {
+        throw std::invalid_argument("Invalid regular expression.");
+    }
+
+    //Автоматът има точно (брой позиции + 1) състояния и няма празни преходи
+    NFA nfa;
+    State* start = nfa.addUnnamedState(expression.nullable);
+    nfa.setStartState(start);
+
+    std::vector<State*> positions;
+    positions.reserve(labels.size());
+    for (size_t position = 0; position < labels.size(); position++)
+    {
+        positions.push_back(nfa.addUnnamedState());
+    }
+    for (size_t position : expression.last)
+    {
+        positions[position]->isFinal = true;
+    }
+
+    //Във всяка позиция се влиза само със символите от нейния етикет
+    auto addTransitions = [&nfa, &labels, &positions](State* source, std::vector<size_t>& targets)
+    {
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        for (size_t target : targets)
+        {
+            for (const SymbolRange& range : labels[target])
+            {
+                nfa.addRangeTransition(source, range.first, range.second, positions[target]);
+            }
+        }
+    };
+
+    addTransitions(start, expression.first);
+    for (size_t position = 0; position < labels.size(); position++)
+    {
+        addTransitions(positions[position], follow[position]);
+    }
+
+    return nfa;
+}
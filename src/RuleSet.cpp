@@ -0,0 +1,343 @@
+﻿#include "RuleSet.hpp"
+#include "MemoryLimit.hpp"
+#include "NFA.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    //Добавя копие на автомата в nfa с празен преход от start към началното му състояние
+    void appendCompiled(NFA& nfa, State* start, const CompiledAutomaton& automaton)
+    {
+        if (automaton.getStartState() == CompiledAutomaton::NO_STATE)
+        {
+            return;
+        }
+
+        std::vector<std::vector<SymbolRange>> classRanges(automaton.getClassCount());
+        for (size_t cls = 1; cls < classRanges.size(); cls++)
+        {
+            classRanges[cls] = automaton.getClassRanges(static_cast<uint16_t>(cls));
+        }
+
+        std::vector<State*> states(automaton.getStateCount());
+        for (uint32_t state = 0; state < states.size(); state++)
+        {
+            states[state] = nfa.addUnnamedState(automaton.isFinal(state));
+        }
+        for (uint32_t state = 0; state < states.size(); state++)
+        {
+            for (size_t edge = automaton.edgeBegin(state); edge < automaton.edgeEnd(state); edge++)
+            {
+                for (const SymbolRange& range : classRanges[automaton.edgeClass(edge)])
+                {
+                    nfa.addRangeTransition(states[state], range.first, range.second, states[automaton.edgeTarget(edge)]);
+                }
+            }
+            for (size_t edge = automaton.epsilonBegin(state); edge < automaton.epsilonEnd(state); edge++)
+            {
+                nfa.addTransition(states[state], '@', states[automaton.epsilonTarget(edge)]);
+            }
+        }
+        nfa.addTransition(start, '@', states[automaton.getStartState()]);
+    }
+}
+
+RuleSet::RuleSet(size_t shardSize, RegexCache::Compiler compiler, size_t mergeBudget)
+    : shardSize(shardSize), compiler(compiler ? std::move(compiler) : RegexCache::Compiler(RegexCache::compileMinimal)),
+    mergeBudget(mergeBudget), nextId(0), changed(false)
+{
+    if (shardSize == 0)
+    {
+        throw std::invalid_argument("Shard size must be positive");
+    }
+}
+
+uint32_t RuleSet::add(const std::string& regex)
+{
+    std::shared_ptr<const CompiledAutomaton> automaton = compiler(regex);
+
+    if (openShards.empty())
+    {
+        openShards.push_back(addShard());
+    }
+    size_t index = openShards.back();
+    Shard& shard = shards[index];
+    if (shard.rules.size() + 1 == shardSize)
+    {
+        openShards.pop_back();
+    }
+
+    uint32_t id = nextId++;
+    shard.rules.push_back({ id, std::move(automaton) });
+    markStale(index);
+    shardOf.emplace(id, index);
+    return id;
+}
+
+bool RuleSet::remove(uint32_t rule)
+{
+    auto found = shardOf.find(rule);
+    if (found == shardOf.end())
+    {
+        return false;
+    }
+
+    size_t index = found->second;
+    shardOf.erase(found);
+    Shard& shard = shards[index];
+    if (shard.rules.size() == shardSize)
+    {
+        openShards.push_back(index);
+    }
+    shard.rules.erase(std::find_if(shard.rules.begin(), shard.rules.end(), [rule](const Rule& r) { return r.id == rule; }));
+    markStale(index);
+    return true;
+}
+
+bool RuleSet::accepts(const std::string& input)
+{
+    refresh();
+    return !tree.empty() && acceptsBelow(tree.size() - 1, 0, input);
+}
+
+std::vector<uint32_t> RuleSet::matches(const std::string& input)
+{
+    refresh();
+    std::vector<uint32_t> result;
+    if (!tree.empty())
+    {
+        matchesBelow(tree.size() - 1, 0, input, result);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void RuleSet::rebuild()
+{
+    refresh();
+    for (size_t level = 1; level < tree.size(); level++)
+    {
+        for (size_t index = 0; index < tree[level].size(); index++)
+        {
+            if (tree[level][index].stale)
+            {
+                build(level, index);
+            }
+        }
+    }
+}
+
+size_t RuleSet::getShardCount() const
+{
+    return std::count_if(shards.begin(), shards.end(), [](const Shard& shard) { return !shard.rules.empty(); });
+}
+
+size_t RuleSet::getStaleShardCount() const
+{
+    if (tree.empty())
+    {
+        return 0;
+    }
+    return std::count_if(tree[0].begin(), tree[0].end(), [](const Node& node) { return node.stale; });
+}
+
+size_t RuleSet::getCoverSize()
+{
+    refresh();
+    return tree.empty() ? 0 : coverBelow(tree.size() - 1, 0);
+}
+
+void RuleSet::markStale(size_t shard)
+{
+    changed = true;
+    for (size_t level = 0; level < tree.size(); level++, shard /= 2)
+    {
+        tree[level][shard].stale = true;
+    }
+}
+
+size_t RuleSet::addShard()
+{
+    shards.emplace_back();
+    changed = true;
+    if (tree.empty())
+    {
+        tree.emplace_back();
+    }
+    tree[0].emplace_back();
+
+    //Всяко ниво има по един възел за всяка двойка възли от нивото под него, а горното ниво - само корена.
+    //Новите възли са отбелязани, затова при следващата проверка се строи пътят от новата група до корена
+    for (size_t level = 1; level < tree.size() || tree[level - 1].size() > 1; level++)
+    {
+        if (level == tree.size())
+        {
+            tree.emplace_back();
+        }
+        size_t size = (tree[level - 1].size() + 1) / 2;
+        if (tree[level].size() < size)
+        {
+            tree[level].resize(size);
+        }
+        tree[level][(tree[0].size() - 1) >> level].stale = true;
+    }
+    return shards.size() - 1;
+}
+
+void RuleSet::refresh()
+{
+    if (!changed)
+    {
+        return;
+    }
+    for (size_t index = 0; index < tree[0].size(); index++)
+    {
+        if (tree[0][index].stale)
+        {
+            build(0, index);
+        }
+    }
+    changed = false;
+}
+
+void RuleSet::build(size_t level, size_t index)
+{
+    Node& node = tree[level][index];
+    node.stale = false;
+    node.automaton = nullptr;
+    node.merged = true;
+
+    std::vector<const CompiledAutomaton*> parts;
+    if (level == 0)
+    {
+        const std::vector<Rule>& rules = shards[index].rules;
+        if (rules.size() == 1)
+        {
+            node.automaton = rules[0].automaton;
+            return;
+        }
+        for (const Rule& rule : rules)
+        {
+            parts.push_back(rule.automaton.get());
+        }
+    }
+    else
+    {
+        //Ако някое дете не е обединено, не е обединен и възелът. Празно дете не участва, а при едно непразно се споделя неговият автомат
+        const std::vector<Node>& children = tree[level - 1];
+        std::vector<const Node*> used;
+        for (size_t child = 2 * index; child < std::min(2 * index + 2, children.size()); child++)
+        {
+            if (!children[child].merged)
+            {
+                node.merged = false;
+                return;
+            }
+            if (children[child].automaton)
+            {
+                used.push_back(&children[child]);
+            }
+        }
+        if (used.size() == 1)
+        {
+            node.automaton = used[0]->automaton;
+            return;
+        }
+        for (const Node* child : used)
+        {
+            parts.push_back(child->automaton.get());
+        }
+    }
+
+    if (!parts.empty())
+    {
+        node.automaton = unionOf(parts);
+        node.merged = node.automaton != nullptr;
+    }
+}
+
+std::shared_ptr<const CompiledAutomaton> RuleSet::unionOf(const std::vector<const CompiledAutomaton*>& parts) const
+{
+    try
+    {
+        MemoryLimit limit(mergeBudget);
+        NFA nfa;
+        State* start = nfa.addUnnamedState();
+        nfa.setStartState(start);
+        for (const CompiledAutomaton* part : parts)
+        {
+            appendCompiled(nfa, start, *part);
+        }
+        return nfa.determinize().minimize().freeze();
+    }
+    catch (const MemoryLimitExceeded&)
+    {
+        return nullptr;
+    }
+}
+
+bool RuleSet::acceptsBelow(size_t level, size_t index, const std::string& input) const
+{
+    const Node& node = tree[level][index];
+    if (node.merged && !node.stale)
+    {
+        return node.automaton && node.automaton->accepts(input);
+    }
+    if (level == 0)
+    {
+        const std::vector<Rule>& rules = shards[index].rules;
+        return std::any_of(rules.begin(), rules.end(), [&input](const Rule& rule) { return rule.automaton->accepts(input); });
+    }
+    for (size_t child = 2 * index; child < std::min(2 * index + 2, tree[level - 1].size()); child++)
+    {
+        if (acceptsBelow(level - 1, child, input))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RuleSet::matchesBelow(size_t level, size_t index, const std::string& input, std::vector<uint32_t>& result) const
+{
+    const Node& node = tree[level][index];
+    if (node.merged && !node.stale && (!node.automaton || !node.automaton->accepts(input)))
+    {
+        return;
+    }
+    if (level == 0)
+    {
+        for (const Rule& rule : shards[index].rules)
+        {
+            if (rule.automaton->accepts(input))
+            {
+                result.push_back(rule.id);
+            }
+        }
+        return;
+    }
+    for (size_t child = 2 * index; child < std::min(2 * index + 2, tree[level - 1].size()); child++)
+    {
+        matchesBelow(level - 1, child, input, result);
+    }
+}
+
+size_t RuleSet::coverBelow(size_t level, size_t index) const
+{
+    const Node& node = tree[level][index];
+    if (node.merged && !node.stale)
+    {
+        return node.automaton ? 1 : 0;
+    }
+    if (level == 0)
+    {
+        return shards[index].rules.size();
+    }
+    size_t count = 0;
+    for (size_t child = 2 * index; child < std::min(2 * index + 2, tree[level - 1].size()); child++)
+    {
+        count += coverBelow(level - 1, child);
+    }
+    return count;
+}
@@ -0,0 +1,91 @@
+﻿#include "Searcher.hpp"
+#include "NFA.hpp"
+
+Searcher::Searcher(const Automaton& automaton)
+{
+    //Σ*L: ново начално състояние с примка с всички символи и празен преход към началното на automaton
+    NFA prefixed;
+    State* start = prefixed.addUnnamedState();
+    prefixed.setStartState(start);
+    prefixed.addRangeTransition(start, 0, 255, start);
+    if (automaton.getStartState())
+    {
+        std::unordered_map<State*, State*> stateMap;
+        automaton.copyStates(automaton, prefixed, stateMap, [](State*, State*) {});
+        automaton.copyTransitions(automaton, prefixed, stateMap);
+        prefixed.addTransition(start, '@', stateMap[automaton.getStartState()]);
+    }
+
+    forward = prefixed.determinize().minimize().freeze();
+    backward = automaton.reverse().determinize().minimize().freeze();
+}
+
+bool Searcher::find(const char* text, size_t length, Match& match, size_t from) const
+{
+    size_t end = 0;
+    if (from > length || !findEnd(text, length, from, end))
+    {
+        return false;
+    }
+
+    //Обратният автомат чете от края назад и запомня последната позиция, в която е във финално състояние. Такава има,
+    //защото правият автомат е намерил съвпадение, което започва не по-рано от from
+    size_t begin = end;
+    uint32_t state = backward->getStartState();
+    for (size_t position = end; position > from;)
+    {
+        state = backward->next(state, static_cast<unsigned char>(text[--position]));
+        if (state == CompiledAutomaton::NO_STATE)
+        {
+            break;
+        }
+        if (backward->isFinal(state))
+        {
+            begin = position;
+        }
+    }
+
+    match = { begin, end };
+    return true;
+}
+
+bool Searcher::contains(const char* text, size_t length) const
+{
+    size_t end = 0;
+    return findEnd(text, length, 0, end);
+}
+
+bool Searcher::findEnd(const char* text, size_t length, size_t from, size_t& end) const
+{
+    uint32_t state = forward->getStartState();
+    if (state == CompiledAutomaton::NO_STATE)
+    {
+        return false;
+    }
+
+    end = from;
+    bool found = forward->isFinal(state);
+    while (!found && end < length)
+    {
+        state = forward->next(state, static_cast<unsigned char>(text[end++]));
+        if (state == CompiledAutomaton::NO_STATE)
+        {
+            return false;
+        }
+        found = forward->isFinal(state);
+    }
+    return found;
+}
+
+std::vector<Searcher::Match> Searcher::findAll(const std::string& text) const
+{
+    std::vector<Match> matches;
+    Match match;
+    size_t from = 0;
+    while (find(text, match, from))
+    {
+        matches.push_back(match);
+        from = match.end > match.begin ? match.end : match.end + 1;
+    }
+    return matches;
+}
@@ -1,14 +1,134 @@
 #include "State.hpp"
+#include "MemoryLimit.hpp"
+#include <algorithm>
 
 void State::addTransition(char symbol, State* destination) {
-    transitions[symbol].push_back(destination);
+    if (symbol == '@') {
+        MemoryLimit::charge(sizeof(State*));
+        epsilonTransitions.push_back(destination);
+        return;
+    }
+
+    unsigned char c = static_cast<unsigned char>(symbol);
+    addTransition(c, c, destination);
 }
 
-const std::vector<State*> State::getTransitions(char symbol) const {
-    auto it = transitions.find(symbol);
-    return it != transitions.end() ? it->second : std::vector<State*>{};
+void State::addTransition(unsigned char low, unsigned char high, State* destination) {
+    //Отчита се най-лошият случай за едно добавяне: нов интервал с едно състояние
+    MemoryLimit::charge(sizeof(TransitionRange) + sizeof(State*));
+
+    //Чести случаи, при които не е нужно да строим интервалите наново: интервалът е след всички досегашни или съвпада с някой от тях
+    if (transitions.empty() || transitions.back().high < low) {
+        if (!transitions.empty() && transitions.back().high + 1 == low
+            && transitions.back().destinations.size() == 1 && transitions.back().destinations[0] == destination) {
+            transitions.back().high = high;
+        }
+        else {
+            transitions.push_back({ low, high, { destination } });
+        }
+        return;
+    }
+
+    auto existing = std::upper_bound(transitions.begin(), transitions.end(), low,
+        [](unsigned char c, const TransitionRange& range) { return c < range.low; });
+    if (existing != transitions.begin() && (existing - 1)->low == low && (existing - 1)->high == high) {
+        --existing;
+        std::vector<State*>& destinations = existing->destinations;
+        if (std::find(destinations.begin(), destinations.end(), destination) != destinations.end()) {
+            return;
+        }
+        destinations.push_back(destination);
+
+        //Интервалът може вече да има същите преходи като съседите си
+        bool mergesWithPrevious = existing != transitions.begin() && (existing - 1)->high + 1 == low && (existing - 1)->destinations == destinations;
+        bool mergesWithNext = existing + 1 != transitions.end() && (existing + 1)->low == high + 1 && (existing + 1)->destinations == destinations;
+        if (!mergesWithPrevious && !mergesWithNext) {
+            return;
+        }
+    }
+
+    std::vector<TransitionRange> result;
+    result.reserve(transitions.size() + 2);
+
+    auto withDestination = [destination](std::vector<State*> destinations) {
+        if (std::find(destinations.begin(), destinations.end(), destination) == destinations.end()) {
+            destinations.push_back(destination);
+        }
+        return destinations;
+    };
+
+    //Първият символ от [low, high], който още не е добавен в резултата
+    int next = low;
+
+    for (const TransitionRange& range : transitions) {
+        if (range.high < low) {
+            result.push_back(range);
+            continue;
+        }
+        if (range.low > high) {
+            if (next <= high) {
+                result.push_back({ static_cast<unsigned char>(next), high, { destination } });
+                next = high + 1;
+            }
+            result.push_back(range);
+            continue;
+        }
+
+        //Интервалът се пресича с [low, high] - разделяме го на до три части
+        if (range.low < low) {
+            result.push_back({ range.low, static_cast<unsigned char>(low - 1), range.destinations });
+        }
+        if (next < range.low) {
+            result.push_back({ static_cast<unsigned char>(next), static_cast<unsigned char>(range.low - 1), { destination } });
+        }
+        unsigned char overlapLow = std::max(range.low, low);
+        unsigned char overlapHigh = std::min(range.high, high);
+        result.push_back({ overlapLow, overlapHigh, withDestination(range.destinations) });
+        next = overlapHigh + 1;
+        if (range.high > high) {
+            result.push_back({ static_cast<unsigned char>(high + 1), range.high, range.destinations });
+        }
+    }
+
+    if (next <= high) {
+        result.push_back({ static_cast<unsigned char>(next), high, { destination } });
+    }
+
+    //Сливаме съседните интервали с еднакви преходи
+    transitions.clear();
+    for (TransitionRange& range : result) {
+        if (!transitions.empty() && transitions.back().high + 1 == range.low && transitions.back().destinations == range.destinations) {
+            transitions.back().high = range.high;
+        }
+        else {
+            transitions.push_back(std::move(range));
+        }
+    }
+}
+
+const std::vector<State*>& State::getTransitions(char symbol) const {
+    static const std::vector<State*> noTransitions;
+
+    if (symbol == '@') {
+        return epsilonTransitions;
+    }
+
+    const TransitionRange* range = findRange(static_cast<unsigned char>(symbol));
+    return range ? range->destinations : noTransitions;
 }
 
 bool State::hasTransition(char symbol) const {
-    return transitions.find(symbol) != transitions.end();
-}
\ No newline at end of file
+    return symbol == '@' ? !epsilonTransitions.empty() : findRange(static_cast<unsigned char>(symbol)) != nullptr;
+}
+
+const TransitionRange* State::findRange(unsigned char symbol) const {
+    //Първият интервал, който започва след символа. Търсеният е точно преди него
+    auto it = std::upper_bound(transitions.begin(), transitions.end(), symbol,
+        [](unsigned char c, const TransitionRange& range) { return c < range.low; });
+
+    if (it == transitions.begin()) {
+        return nullptr;
+    }
+    --it;
+    return symbol <= it->high ? &*it : nullptr;
+}
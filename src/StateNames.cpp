@@ -0,0 +1,184 @@
+﻿#include "StateNames.hpp"
+
+void StateNames::setName(size_t state, const std::string& name)
+{
+    setLabel(state, name.empty() ? Label{ Kind::Unnamed, 0, 0, 0 } : Label{ Kind::Interned, intern(name), 0, 0 });
+}
+
+void StateNames::setDerived(size_t state, const std::shared_ptr<const StateNames>& source, size_t sourceState)
+{
+    if (source && source->hasLabel(sourceState))
+    {
+        setLabel(state, derivedLabel(source, sourceState));
+    }
+    else if (state < labels.size())
+    {
+        labels[state] = { Kind::Unnamed, 0, 0, 0 };
+    }
+}
+
+void StateNames::setPair(size_t state, const std::shared_ptr<const StateNames>& left, size_t leftState,
+    const std::shared_ptr<const StateNames>& right, size_t rightState)
+{
+    if (!left && !right)
+    {
+        setLabel(state, { Kind::Unnamed, 0, 0, 0 });
+        return;
+    }
+
+    //Двойката пази двете таблици на последователни места в sources
+    uint32_t slot = static_cast<uint32_t>(sources.size());
+    if (sources.size() >= 2 && sources[sources.size() - 2] == left && sources.back() == right)
+    {
+        slot -= 2;
+    }
+    else
+    {
+        sources.push_back(left);
+        sources.push_back(right);
+    }
+    setLabel(state, { Kind::Pair, slot, static_cast<uint32_t>(leftState), static_cast<uint32_t>(rightState) });
+}
+
+std::string StateNames::getName(size_t state) const
+{
+    if (state >= labels.size())
+    {
+        return "";
+    }
+
+    const Label& label = labels[state];
+    switch (label.kind)
+    {
+    case Kind::Interned:
+        return pool[label.value];
+    case Kind::Derived:
+        return sources[label.value]->getName(label.first);
+    case Kind::Pair:
+    {
+        //Ако само едната страна има име, другата се показва с индекса си
+        auto sideName = [](const std::shared_ptr<const StateNames>& side, size_t sideState) {
+            return side && side->hasName(sideState) ? side->getName(sideState) : "q" + std::to_string(sideState);
+        };
+        if (!hasName(state))
+        {
+            return "";
+        }
+        return sideName(sources[label.value], label.first) + "_" + sideName(sources[label.value + 1], label.second);
+    }
+    default:
+        return "";
+    }
+}
+
+bool StateNames::hasName(size_t state) const
+{
+    if (state >= labels.size())
+    {
+        return false;
+    }
+
+    const Label& label = labels[state];
+    switch (label.kind)
+    {
+    case Kind::Interned:
+        return true;
+    case Kind::Derived:
+        return sources[label.value]->hasName(label.first);
+    case Kind::Pair:
+        return (sources[label.value] && sources[label.value]->hasName(label.first))
+            || (sources[label.value + 1] && sources[label.value + 1]->hasName(label.second));
+    default:
+        return false;
+    }
+}
+
+void StateNames::keepOnly(const std::vector<bool>& keep)
+{
+    size_t kept = 0;
+    for (size_t state = 0; state < labels.size(); state++)
+    {
+        if (keep[state])
+        {
+            labels[kept++] = labels[state];
+        }
+    }
+    labels.resize(kept);
+}
+
+size_t StateNames::memoryUsage() const
+{
+    //Низовете заемат динамична памет само ако не се побират в самия обект
+    auto stringBytes = [](const std::string& text) {
+        const char* object = reinterpret_cast<const char*>(&text);
+        return text.data() >= object && text.data() < object + sizeof(text) ? 0 : text.capacity() + 1;
+    };
+
+    size_t bytes = sizeof(*this) + labels.capacity() * sizeof(Label) + pool.capacity() * sizeof(std::string)
+        + sources.capacity() * sizeof(sources[0]);
+    for (const std::string& name : pool)
+    {
+        bytes += stringBytes(name);
+    }
+    for (const auto& entry : poolIndex)
+    {
+        bytes += sizeof(void*) + sizeof(entry) + stringBytes(entry.first);
+    }
+    bytes += poolIndex.bucket_count() * sizeof(void*);
+    bytes += sourceIndex.size() * (sizeof(void*) + sizeof(*sourceIndex.begin())) + sourceIndex.bucket_count() * sizeof(void*);
+    return bytes;
+}
+
+bool StateNames::hasLabel(size_t state) const
+{
+    return state < labels.size() && labels[state].kind != Kind::Unnamed;
+}
+
+void StateNames::setLabel(size_t state, const Label& label)
+{
+    if (state >= labels.size())
+    {
+        if (label.kind == Kind::Unnamed)
+        {
+            return;
+        }
+        labels.resize(state + 1, { Kind::Unnamed, 0, 0, 0 });
+    }
+    labels[state] = label;
+}
+
+uint32_t StateNames::intern(const std::string& name)
+{
+    auto found = poolIndex.find(name);
+    if (found != poolIndex.end())
+    {
+        return found->second;
+    }
+    uint32_t index = static_cast<uint32_t>(pool.size());
+    pool.push_back(name);
+    poolIndex.emplace(name, index);
+    return index;
+}
+
+uint32_t StateNames::sourceSlot(const std::shared_ptr<const StateNames>& source)
+{
+    auto found = sourceIndex.find(source.get());
+    if (found != sourceIndex.end())
+    {
+        return found->second;
+    }
+    uint32_t slot = static_cast<uint32_t>(sources.size());
+    sources.push_back(source);
+    sourceIndex.emplace(source.get(), slot);
+    return slot;
+}
+
+StateNames::Label StateNames::derivedLabel(const std::shared_ptr<const StateNames>& source, size_t state)
+{
+    const Label& label = source->labels[state];
+    if (label.kind == Kind::Derived)
+    {
+        return { Kind::Derived, sourceSlot(source->sources[label.value]), label.first, 0 };
+    }
+    return { Kind::Derived, sourceSlot(source), static_cast<uint32_t>(state), 0 };
+}
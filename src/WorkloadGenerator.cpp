@@ -0,0 +1,341 @@
+﻿#include "WorkloadGenerator.hpp"
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
+uint64_t WorkloadGenerator::below(uint64_t bound)
+{
+    //Отхвърляме стойностите от последния непълен период, за да е разпределението равномерно
+    uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+    uint64_t value;
+    do
+    {
+        value = random();
+    } while (value >= limit);
+    return value % bound;
+}
+
+bool WorkloadGenerator::chance(double probability)
+{
+    return static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0) < probability;
+}
+
+size_t WorkloadGenerator::count(double average)
+{
+    size_t whole = static_cast<size_t>(average);
+    return whole + (chance(average - static_cast<double>(whole)) ? 1 : 0);
+}
+
+void WorkloadGenerator::checkAlphabetSize(size_t alphabetSize)
+{
+    if (alphabetSize == 0 || alphabetSize > MAX_ALPHABET_SIZE)
+    {
+        throw std::invalid_argument("Alphabet size must be between 1 and " + std::to_string(MAX_ALPHABET_SIZE));
+    }
+}
+
+DFA WorkloadGenerator::randomDFA(size_t stateCount, size_t alphabetSize, double density, double finalRatio)
+{
+    checkAlphabetSize(alphabetSize);
+    DFA dfa;
+    for (size_t i = 0; i < stateCount; i++)
+    {
+        State* state = dfa.addUnnamedState(chance(finalRatio));
+        if (i == 0)
+        {
+            dfa.setStartState(state);
+            continue;
+        }
+
+        //Преход към новото състояние от някое от предишните, което има свободен символ. Последното добавено винаги има
+        const std::vector<State*>& states = dfa.getStates();
+        State* parent = states[below(i)];
+        std::vector<char> free;
+        for (size_t k = 0; k < alphabetSize; k++)
+        {
+            if (!parent->hasTransition(static_cast<char>('a' + k)))
+            {
+                free.push_back(static_cast<char>('a' + k));
+            }
+        }
+        if (free.empty())
+        {
+            parent = states[i - 1];
+            for (size_t k = 0; k < alphabetSize; k++)
+            {
+                free.push_back(static_cast<char>('a' + k));
+            }
+        }
+        dfa.addTransition(parent, free[below(free.size())], state);
+    }
+
+    for (State* state : dfa.getStates())
+    {
+        for (size_t k = 0; k < alphabetSize; k++)
+        {
+            char symbol = static_cast<char>('a' + k);
+            if (!state->hasTransition(symbol) && chance(density))
+            {
+                dfa.addTransition(state, symbol, dfa.getStates()[below(stateCount)]);
+            }
+        }
+    }
+    return dfa;
+}
+
+NFA WorkloadGenerator::randomNFA(size_t stateCount, size_t alphabetSize, double density, double epsilonDensity, double finalRatio)
+{
+    checkAlphabetSize(alphabetSize);
+    NFA nfa;
+    for (size_t i = 0; i < stateCount; i++)
+    {
+        State* state = nfa.addUnnamedState(chance(finalRatio));
+        if (i == 0)
+        {
+            nfa.setStartState(state);
+        }
+        else
+        {
+            nfa.addTransition(nfa.getStates()[below(i)], static_cast<char>('a' + below(alphabetSize)), state);
+        }
+    }
+
+    const std::vector<State*>& states = nfa.getStates();
+    for (State* state : states)
+    {
+        for (size_t k = 0; k < alphabetSize; k++)
+        {
+            for (size_t edges = count(density); edges > 0; edges--)
+            {
+                nfa.addTransition(state, static_cast<char>('a' + k), states[below(stateCount)]);
+            }
+        }
+        for (size_t edges = count(epsilonDensity); edges > 0; edges--)
+        {
+            nfa.addTransition(state, '@', states[below(stateCount)]);
+        }
+    }
+    return nfa;
+}
+
+std::string WorkloadGenerator::randomRegex(size_t depth, size_t alphabetSize)
+{
+    checkAlphabetSize(alphabetSize);
+    uint64_t kind = depth == 0 ? 0 : below(8);
+    if (kind < 2)
+    {
+        //Лист: буква, а понякога клас от букви или празната дума
+        uint64_t leaf = below(10);
+        if (leaf == 0)
+        {
+            return "@";
+        }
+        char low = static_cast<char>('a' + below(alphabetSize));
+        if (leaf == 1)
+        {
+            char high = static_cast<char>(low + below('a' + alphabetSize - low));
+            return std::string("[") + low + "-" + high + "]";
+        }
+        return std::string(1, low);
+    }
+    if (kind == 2)
+    {
+        return "(" + randomRegex(depth - 1, alphabetSize) + ")*";
+    }
+    std::string left = randomRegex(depth - 1, alphabetSize);
+    std::string right = randomRegex(depth - 1, alphabetSize);
+    return "(" + left + (kind < 6 ? "." : "+") + right + ")";
+}
+
+std::string WorkloadGenerator::blowupRegex(size_t n)
+{
+    std::string regex = "(a+b)*.a";
+    for (size_t i = 0; i < n; i++)
+    {
+        regex += ".(a+b)";
+    }
+    return regex;
+}
+
+std::string WorkloadGenerator::nestedRegex(size_t depth)
+{
+    std::string regex = "a";
+    for (size_t i = 0; i < depth; i++)
+    {
+        regex = "(" + regex + "." + (i % 2 == 0 ? "b" : "a") + ")*";
+    }
+    return regex;
+}
+
+std::string WorkloadGenerator::randomText(size_t length, size_t alphabetSize)
+{
+    checkAlphabetSize(alphabetSize);
+    std::string text(length, 'a');
+    for (char& c : text)
+    {
+        c = static_cast<char>('a' + below(alphabetSize));
+    }
+    return text;
+}
+
+WorkloadGenerator::WalkTable WorkloadGenerator::buildWalkTable(const Automaton& automaton)
+{
+    const std::vector<State*>& states = automaton.getStates();
+    const size_t n = states.size();
+
+    //Обратните ребра с цена 1 за символ и 0 за празен преход
+    std::vector<std::vector<std::pair<size_t, Step>>> incoming(n);
+    for (const State* state : states)
+    {
+        for (const TransitionRange& range : state->transitions)
+        {
+            for (const State* next : range.destinations)
+            {
+                incoming[next->id].push_back({ state->id, { next->id, range.low, range.high, false } });
+            }
+        }
+        for (const State* next : state->epsilonTransitions)
+        {
+            incoming[next->id].push_back({ state->id, { next->id, 0, 0, true } });
+        }
+    }
+
+    //0-1 BFS от финалните състояния
+    WalkTable table{ std::vector<size_t>(n, UNREACHABLE), std::vector<Step>(n) };
+    std::deque<size_t> queue;
+    for (const State* state : states)
+    {
+        if (state->isFinal)
+        {
+            table.distance[state->id] = 0;
+            queue.push_back(state->id);
+        }
+    }
+    while (!queue.empty())
+    {
+        size_t current = queue.front();
+        queue.pop_front();
+        for (const auto& edge : incoming[current])
+        {
+            size_t distance = table.distance[current] + (edge.second.epsilon ? 0 : 1);
+            if (distance < table.distance[edge.first])
+            {
+                table.distance[edge.first] = distance;
+                table.shortest[edge.first] = edge.second;
+                if (edge.second.epsilon)
+                {
+                    queue.push_front(edge.first);
+                }
+                else
+                {
+                    queue.push_back(edge.first);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+bool WorkloadGenerator::walk(const Automaton& automaton, const WalkTable& table, size_t maxLength, std::string& word)
+{
+    const State* start = automaton.getStartState();
+    if (!start || table.distance[start->id] > maxLength)
+    {
+        return false;
+    }
+
+    //Случайно обхождане, при което от всяко състояние остава път до финално в рамките на maxLength. Спира във финално
+    //състояние, щом думата достигне случайно избраната дължина, или след твърде много стъпки (празните преходи може да са в цикъл)
+    size_t target = below(maxLength + 1);
+    size_t stepLimit = 4 * (maxLength + automaton.getStateCount());
+    const State* state = start;
+    word.clear();
+    std::vector<Step> options;
+    for (size_t steps = 0; steps < stepLimit; steps++)
+    {
+        if (state->isFinal && word.size() >= target)
+        {
+            return true;
+        }
+
+        size_t remaining = maxLength - word.size();
+        options.clear();
+        for (const TransitionRange& range : state->transitions)
+        {
+            for (const State* next : range.destinations)
+            {
+                if (remaining > 0 && table.distance[next->id] <= remaining - 1)
+                {
+                    options.push_back({ next->id, range.low, range.high, false });
+                }
+            }
+        }
+        for (const State* next : state->epsilonTransitions)
+        {
+            if (table.distance[next->id] <= remaining)
+            {
+                options.push_back({ next->id, 0, 0, true });
+            }
+        }
+        if (options.empty())
+        {
+            break;
+        }
+
+        const Step& step = options[below(options.size())];
+        if (!step.epsilon)
+        {
+            word.push_back(static_cast<char>(step.low + below(step.high - step.low + 1)));
+        }
+        state = automaton.getStates()[step.next];
+    }
+
+    //Довършваме по най-краткия път. Разстоянието намалява по него, затова думата остава в рамките на maxLength
+    while (!state->isFinal)
+    {
+        const Step& step = table.shortest[state->id];
+        if (!step.epsilon)
+        {
+            word.push_back(static_cast<char>(step.low + below(step.high - step.low + 1)));
+        }
+        state = automaton.getStates()[step.next];
+    }
+    return true;
+}
+
+bool WorkloadGenerator::acceptedWord(const Automaton& automaton, size_t maxLength, std::string& word)
+{
+    return walk(automaton, buildWalkTable(automaton), maxLength, word);
+}
+
+std::vector<std::string> WorkloadGenerator::corpus(const Automaton& automaton, size_t count, size_t maxLength, double acceptedRatio)
+{
+    WalkTable table = buildWalkTable(automaton);
+
+    //Азбуката се подрежда, защото редът на unordered_set зависи от стандартната библиотека
+    std::vector<char> alphabet(automaton.getAlphabet().begin(), automaton.getAlphabet().end());
+    std::sort(alphabet.begin(), alphabet.end());
+    if (alphabet.empty())
+    {
+        alphabet.push_back('a');
+    }
+
+    std::vector<std::string> words;
+    words.reserve(count);
+    std::string word;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (chance(acceptedRatio) && walk(automaton, table, maxLength, word))
+        {
+            words.push_back(word);
+            continue;
+        }
+        word.resize(below(maxLength + 1));
+        for (char& c : word)
+        {
+            c = alphabet[below(alphabet.size())];
+        }
+        words.push_back(word);
+    }
+    return words;
+}
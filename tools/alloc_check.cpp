@@ -0,0 +1,136 @@
+﻿//Проверява, че разпознаването с детерминирани автомати и достъпът до състоянията и преходите не заделят памет.
+//Глобалният operator new е заменен с брояч. За всяка проверка се сравнява броят заделяния преди и след извикването.
+//Програмата завършва с код 1, ако някоя проверка заделя памет.
+//
+//Употреба: alloc_check
+
+#include "CompiledAutomaton.hpp"
+#include "DFA.hpp"
+#include "HybridAutomaton.hpp"
+#include "NFA.hpp"
+#include "RegexToNFA.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+
+namespace
+{
+    std::atomic<size_t> allocations(0);
+
+    void* allocate(size_t size)
+    {
+        allocations++;
+        void* pointer = std::malloc(size ? size : 1);
+        if (!pointer)
+        {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    allocations++;
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    allocations++;
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+namespace
+{
+    int failures = 0;
+
+    //Изпълнява action и проверява, че не е заделило памет. Резултатът се събира в sink, за да не бъде премахнато извикването
+    void expectNoAllocations(const char* name, const std::function<size_t()>& action)
+    {
+        static volatile size_t sink = 0;
+        size_t before = allocations.load();
+        sink = sink + action();
+        size_t count = allocations.load() - before;
+        std::printf("%-40s %s", name, count == 0 ? "ok\n" : "FAILED: ");
+        if (count != 0)
+        {
+            std::printf("%zu allocations\n", count);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    NFA nfa = RegexToNFA::fromRegex("(a+b)*.a.b.(a+b+c)*.c");
+    DFA dfa = nfa.determinize().minimize();
+    std::shared_ptr<const CompiledAutomaton> compiled = dfa.freeze();
+    std::shared_ptr<const HybridAutomaton> hybrid = std::make_shared<HybridAutomaton>(nfa, 1024);
+    //С малко състояния разпознаването преминава към симулация и се връща в детерминираната част
+    std::shared_ptr<const HybridAutomaton> partial = std::make_shared<HybridAutomaton>(nfa, 2);
+    std::string input;
+    for (int i = 0; i < 100000; i++)
+    {
+        input += "abcab"[i % 5];
+    }
+    input += "abc";
+
+    //Функциите се създават предварително, за да не се брои паметта на std::function
+    CompiledAutomaton::Matcher matcher(compiled);
+    HybridAutomaton::Matcher hybridMatcher(hybrid);
+    HybridAutomaton::Matcher partialMatcher(partial);
+    std::function<size_t()> checks[] = {
+        [&]() { return size_t(dfa.accepts(input)); },
+        [&]() { return size_t(compiled->accepts(input)); },
+        [&]() { matcher.reset(); matcher.feed(input.data(), input.size()); return size_t(matcher.isAccepting()); },
+        [&]() { hybridMatcher.reset(); hybridMatcher.feed(input.data(), input.size()); return size_t(hybridMatcher.isAccepting()); },
+        [&]() { partialMatcher.reset(); partialMatcher.feed(input.data(), input.size()); return size_t(partialMatcher.isAccepting()); },
+        [&]() {
+            size_t total = 0;
+            for (State* state : dfa.getStates())
+            {
+                total += dfa.getNextStates(state, 'a').size() + state->getTransitions('b').size() + state->transitions.size();
+                total += state->findRange('c') != nullptr;
+            }
+            return total + dfa.getAlphabet().size();
+        },
+        [&]() {
+            size_t total = 0;
+            for (State* state : nfa.getStates())
+            {
+                total += nfa.getNextStates(state, '@').size() + state->getTransitions('a').size();
+            }
+            return total;
+        },
+    };
+    const char* names[] = {
+        "DFA::accepts",
+        "CompiledAutomaton::accepts",
+        "CompiledAutomaton::Matcher::feed",
+        "HybridAutomaton::Matcher::feed",
+        "HybridAutomaton::Matcher::feed (partial)",
+        "DFA state and transition views",
+        "NFA state and transition views",
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        expectNoAllocations(names[i], checks[i]);
+    }
+
+    if (!compiled->isDeterministic() || !hybrid->isComplete() || partial->isComplete())
+    {
+        std::printf("the automata under test are expected to be deterministic\n");
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
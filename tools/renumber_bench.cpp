@@ -0,0 +1,221 @@
+﻿//Сравнява скоростта на CompiledAutomaton::accepts преди и след преномериране на състоянията според profile.
+//Автоматът е речник (DictionaryBuilder) от думите във файл или от случайни думи, или случаен детерминиран автомат.
+//Заявките са изкривени: повечето са думи от малко "горещо" подмножество, затова малка част от състоянията се посещава често.
+//Профилът се събира от обучаващи заявки, а времето се мери с други заявки от същото разпределение.
+//
+//Употреба: renumber_bench [-s seed] [-w думи] [-d състояния] [-q заявки] [-i повторения] [файл с думи]
+//  -s  seed на WorkloadGenerator (по подразбиране 1)
+//  -w  брой случайни думи в речника, ако няма файл (по подразбиране 300000)
+//  -d  вместо речник се използва случаен детерминиран автомат с толкова състояния
+//  -q  брой заявки за обучение и за измерване (по подразбиране 200000)
+//  -i  колко пъти се измерва; извежда се най-доброто време (по подразбиране 5)
+//
+//За броя на пропуските в кеша: perf stat -e cache-misses,cache-references ./renumber_bench
+//или valgrind --tool=cachegrind ./renumber_bench -i 1 (по-бавно, но точно и без нужда от права за perf)
+
+#include "CompiledAutomaton.hpp"
+#include "DFA.hpp"
+#include "DictionaryBuilder.hpp"
+#include "WorkloadGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //Делът на заявките от горещото подмножество и неговият размер спрямо всички думи
+    const double HOT_QUERY_RATIO = 0.9;
+    const double HOT_WORD_RATIO = 0.01;
+
+    const size_t MAX_WORD_LENGTH = 16;
+    const size_t ALPHABET_SIZE = 26;
+
+    struct Options
+    {
+        uint64_t seed = 1;
+        size_t words = 300000;
+        size_t randomStates = 0;
+        size_t queries = 200000;
+        size_t iterations = 5;
+        std::string wordFile;
+    };
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+        {
+            std::string option = argv[i];
+            if (i + 1 >= argc || option.size() != 2)
+            {
+                return false;
+            }
+            unsigned long long value = std::strtoull(argv[++i], nullptr, 10);
+            switch (option[1])
+            {
+            case 's': options.seed = value; break;
+            case 'w': options.words = static_cast<size_t>(value); break;
+            case 'd': options.randomStates = static_cast<size_t>(value); break;
+            case 'q': options.queries = static_cast<size_t>(value); break;
+            case 'i': options.iterations = static_cast<size_t>(value); break;
+            default: return false;
+            }
+        }
+        if (i < argc)
+        {
+            options.wordFile = argv[i++];
+        }
+        return i == argc && options.queries > 0 && options.iterations > 0;
+    }
+
+    std::vector<std::string> readWords(const std::string& fileName)
+    {
+        std::ifstream file(fileName);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open " + fileName);
+        }
+        std::vector<std::string> words;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty())
+            {
+                words.push_back(line);
+            }
+        }
+        return words;
+    }
+
+    //Заявки, в които дял HOT_QUERY_RATIO са от първите HOT_WORD_RATIO от words, а останалите - от всички думи
+    std::vector<std::string> skewedQueries(WorkloadGenerator& generator, const std::vector<std::string>& words, size_t count)
+    {
+        size_t hotCount = std::max<size_t>(1, static_cast<size_t>(words.size() * HOT_WORD_RATIO));
+        std::vector<std::string> queries;
+        queries.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            //Индексът се взима от случайна дума, за да се използва само генераторът и резултатът да зависи само от seed
+            std::string text = generator.randomText(8, ALPHABET_SIZE);
+            uint64_t random = 0;
+            for (char symbol : text)
+            {
+                random = random * ALPHABET_SIZE + static_cast<uint64_t>(symbol - 'a');
+            }
+            bool hot = random % 1000 < HOT_QUERY_RATIO * 1000;
+            queries.push_back(words[(random / 1000) % (hot ? hotCount : words.size())]);
+        }
+        return queries;
+    }
+
+    //Най-доброто време (в секунди) от iterations обхождания на queries и броят на приетите думи
+    double measure(const CompiledAutomaton& automaton, const std::vector<std::string>& queries, size_t iterations, size_t& accepted)
+    {
+        double best = 0;
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            size_t count = 0;
+            for (const std::string& query : queries)
+            {
+                count += automaton.accepts(query);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (iteration == 0 || seconds < best)
+            {
+                best = seconds;
+            }
+            accepted = count;
+        }
+        return best;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: renumber_bench [-s seed] [-w words] [-d states] [-q queries] [-i iterations] [word file]" << std::endl;
+        return 2;
+    }
+
+    WorkloadGenerator generator(options.seed);
+    DFA dfa;
+    std::vector<std::string> words;
+    try
+    {
+        if (options.randomStates > 0)
+        {
+            dfa = generator.randomDFA(options.randomStates, ALPHABET_SIZE, 0.5);
+            words = generator.corpus(dfa, std::max<size_t>(options.queries / 10, 1), MAX_WORD_LENGTH * 4);
+        }
+        else
+        {
+            if (!options.wordFile.empty())
+            {
+                words = readWords(options.wordFile);
+            }
+            else
+            {
+                for (size_t i = 0; i < options.words; i++)
+                {
+                    words.push_back(generator.randomText(4 + i % (MAX_WORD_LENGTH - 3), ALPHABET_SIZE));
+                }
+            }
+            dfa = DictionaryBuilder::fromWords(words);
+        }
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 2;
+    }
+    if (words.empty())
+    {
+        std::cerr << "No words" << std::endl;
+        return 2;
+    }
+
+    std::shared_ptr<const CompiledAutomaton> original = dfa.freeze();
+    std::vector<std::string> training = skewedQueries(generator, words, options.queries);
+    std::vector<std::string> queries = skewedQueries(generator, words, options.queries);
+    size_t bytes = 0;
+    for (const std::string& query : queries)
+    {
+        bytes += query.size();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const CompiledAutomaton> renumbered = original->renumbered(original->profile(training));
+    double renumberSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t originalAccepted = 0;
+    size_t renumberedAccepted = 0;
+    double originalSeconds = measure(*original, queries, options.iterations, originalAccepted);
+    double renumberedSeconds = measure(*renumbered, queries, options.iterations, renumberedAccepted);
+
+    std::printf("states: %zu, classes: %zu, memory: %zu bytes\n", original->getStateCount(), original->getClassCount(), original->memoryUsage());
+    std::printf("queries: %zu (%zu bytes), profile + renumbered: %.3f s\n", queries.size(), bytes, renumberSeconds);
+    std::printf("original:   %.3f s (%.1f MB/s)\n", originalSeconds, originalSeconds > 0 ? bytes / originalSeconds / 1e6 : 0.0);
+    std::printf("renumbered: %.3f s (%.1f MB/s), speedup %.2fx\n", renumberedSeconds,
+        renumberedSeconds > 0 ? bytes / renumberedSeconds / 1e6 : 0.0, renumberedSeconds > 0 ? originalSeconds / renumberedSeconds : 0.0);
+
+    if (originalAccepted != renumberedAccepted)
+    {
+        std::fprintf(stderr, "accepted counts differ: %zu and %zu\n", originalAccepted, renumberedAccepted);
+        return 1;
+    }
+    return 0;
+}
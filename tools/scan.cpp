@@ -0,0 +1,363 @@
+﻿//Търсене на редове, които съдържат дума от езика на регулярен израз, в големи файлове (подобно на grep).
+//Файлът се чете с mmap, разделя се на части, които завършват в края на ред, и частите се обработват от няколко нишки.
+//Резултатите се извеждат в реда на частите чрез буфер за пренареждане, а накрая в стандартния изход за грешки се извежда
+//броят на съвпаденията и скоростта.
+//
+//Употреба: scan [-c] [-v] [-j нишки] [-s] израз файл...
+//  -c  извежда само броя на съвпадащите редове
+//  -v  извежда редовете, които не съдържат съвпадение
+//  -j  брой нишки (по подразбиране std::thread::hardware_concurrency())
+//  -s  извежда статистика (редове, байтове, време, MB/s)
+
+#include "NFA.hpp"
+#include "RegexToNFA.hpp"
+#include "Searcher.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //Размер на една част. Частта се удължава до края на реда
+    const size_t CHUNK_SIZE = size_t(1) << 20;
+
+    //Колко части най-много може да са обработени, но още неизведени. Ограничава паметта на буфера за пренареждане
+    const size_t REORDER_WINDOW_PER_THREAD = 4;
+
+    struct Options
+    {
+        bool countOnly = false;
+        bool invert = false;
+        bool statistics = false;
+        unsigned threads = 0;
+        std::string pattern;
+        std::vector<std::string> files;
+    };
+
+    //Съдържанието на файл в паметта: mmap, а без него (или за празен файл) - прочетено в буфер
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& fileName)
+        {
+#ifndef _WIN32
+            int descriptor = open(fileName.c_str(), O_RDONLY);
+            if (descriptor < 0)
+            {
+                throw std::runtime_error("Could not open " + fileName + ": " + std::strerror(errno));
+            }
+            struct stat info;
+            if (fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+            {
+                void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (address != MAP_FAILED)
+                {
+                    madvise(address, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                    mapped = static_cast<const char*>(address);
+                    length = static_cast<size_t>(info.st_size);
+                }
+            }
+            close(descriptor);
+            if (mapped)
+            {
+                return;
+            }
+#endif
+            std::ifstream file(fileName, std::ios::in | std::ios::binary);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Could not open " + fileName);
+            }
+            buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            length = buffer.size();
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if (mapped)
+            {
+                munmap(const_cast<char*>(mapped), length);
+            }
+#endif
+        }
+
+        const char* data() const { return mapped ? mapped : buffer.data(); }
+        size_t size() const { return length; }
+
+    private:
+        const char* mapped = nullptr;
+        size_t length = 0;
+        std::vector<char> buffer;
+    };
+
+    //Резултатът от обработката на една част
+    struct ChunkResult
+    {
+        std::string output;
+        size_t lines = 0;
+        size_t matches = 0;
+        bool done = false;
+    };
+
+    //Разделя [0, size) на части с дължина около CHUNK_SIZE, всяка от които завършва след '\n' или в края на файла
+    std::vector<size_t> chunkBoundaries(const char* data, size_t size)
+    {
+        std::vector<size_t> boundaries{ 0 };
+        while (boundaries.back() < size)
+        {
+            size_t end = std::min(boundaries.back() + CHUNK_SIZE, size);
+            const void* newline = end < size ? std::memchr(data + end, '\n', size - end) : nullptr;
+            end = newline ? static_cast<const char*>(newline) - data + 1 : size;
+            boundaries.push_back(end);
+        }
+        return boundaries;
+    }
+
+    //Обработва редовете в [begin, end)
+    void scanChunk(const Searcher& searcher, const Options& options, const char* data, size_t begin, size_t end, ChunkResult& result)
+    {
+        size_t line = begin;
+        while (line < end)
+        {
+            const void* newline = std::memchr(data + line, '\n', end - line);
+            size_t lineEnd = newline ? static_cast<const char*>(newline) - data : end;
+            size_t next = newline ? lineEnd + 1 : end;
+
+            result.lines++;
+            if (searcher.contains(data + line, lineEnd - line) != options.invert)
+            {
+                result.matches++;
+                if (!options.countOnly)
+                {
+                    result.output.append(data + line, lineEnd - line);
+                    result.output.push_back('\n');
+                }
+            }
+            line = next;
+        }
+    }
+
+    //Обработва файла на няколко нишки и извежда резултатите в реда на частите. Връща броя на съвпадащите редове
+    size_t scanFile(const Searcher& searcher, const Options& options, const MappedFile& file, const std::string& prefix, size_t& lines)
+    {
+        std::vector<size_t> boundaries = chunkBoundaries(file.data(), file.size());
+        const size_t chunkCount = boundaries.size() - 1;
+        const size_t threadCount = std::max<size_t>(1, std::min<size_t>(options.threads, chunkCount));
+        const size_t window = threadCount * REORDER_WINDOW_PER_THREAD;
+
+        std::vector<ChunkResult> results(chunkCount);
+        std::atomic<size_t> nextChunk(0);
+        size_t written = 0; //Броят на изведените части. Пази се от mutex
+        std::mutex mutex;
+        std::condition_variable chunkDone;
+        std::condition_variable chunkWritten;
+
+        auto worker = [&]()
+        {
+            for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+            {
+                {
+                    //Не изпреварваме извеждането с повече от window части
+                    std::unique_lock<std::mutex> lock(mutex);
+                    chunkWritten.wait(lock, [&]() { return chunk < written + window; });
+                }
+                ChunkResult result;
+                scanChunk(searcher, options, file.data(), boundaries[chunk], boundaries[chunk + 1], result);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[chunk] = std::move(result);
+                    results[chunk].done = true;
+                }
+                chunkDone.notify_one();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back(worker);
+        }
+
+        //Буфер за пренареждане: извеждаме частите една след друга, щом следващата е готова
+        size_t matches = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            ChunkResult result;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkDone.wait(lock, [&]() { return results[chunk].done; });
+                result = std::move(results[chunk]);
+                results[chunk] = ChunkResult();
+            }
+
+            matches += result.matches;
+            lines += result.lines;
+            if (!options.countOnly && !result.output.empty())
+            {
+                if (prefix.empty())
+                {
+                    std::fwrite(result.output.data(), 1, result.output.size(), stdout);
+                }
+                else
+                {
+                    //С няколко файла всеки ред започва с името на файла
+                    size_t position = 0;
+                    while (position < result.output.size())
+                    {
+                        size_t lineEnd = result.output.find('\n', position);
+                        std::fwrite(prefix.data(), 1, prefix.size(), stdout);
+                        std::fwrite(result.output.data() + position, 1, lineEnd + 1 - position, stdout);
+                        position = lineEnd + 1;
+                    }
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                written = chunk + 1;
+            }
+            chunkWritten.notify_all();
+        }
+
+        for (std::thread& thread : workers)
+        {
+            thread.join();
+        }
+        return matches;
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+        {
+            std::string option = argv[i];
+            if (option == "-c")
+            {
+                options.countOnly = true;
+            }
+            else if (option == "-v")
+            {
+                options.invert = true;
+            }
+            else if (option == "-s")
+            {
+                options.statistics = true;
+            }
+            else if (option == "-j" && i + 1 < argc)
+            {
+                options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (argc - i < 2)
+        {
+            return false;
+        }
+
+        options.pattern = argv[i++];
+        for (; i < argc; i++)
+        {
+            options.files.push_back(argv[i]);
+        }
+        if (options.threads == 0)
+        {
+            options.threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: scan [-c] [-v] [-j threads] [-s] regex file..." << std::endl;
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Searcher> searcher;
+    try
+    {
+        searcher.reset(new Searcher(RegexToNFA::fromRegex(options.pattern)));
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << "Invalid regex: " << error.what() << std::endl;
+        return 2;
+    }
+    auto compiled = std::chrono::steady_clock::now();
+
+    size_t totalMatches = 0;
+    size_t totalLines = 0;
+    size_t totalBytes = 0;
+    bool failed = false;
+    for (const std::string& fileName : options.files)
+    {
+        try
+        {
+            MappedFile file(fileName);
+            size_t lines = 0;
+            size_t matches = scanFile(*searcher, options, file, options.files.size() > 1 ? fileName + ":" : "", lines);
+            if (options.countOnly)
+            {
+                if (options.files.size() > 1)
+                {
+                    std::printf("%s:", fileName.c_str());
+                }
+                std::printf("%zu\n", matches);
+            }
+            totalMatches += matches;
+            totalLines += lines;
+            totalBytes += file.size();
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << error.what() << std::endl;
+            failed = true;
+        }
+    }
+    std::fflush(stdout);
+
+    if (options.statistics)
+    {
+        auto end = std::chrono::steady_clock::now();
+        double compileSeconds = std::chrono::duration<double>(compiled - start).count();
+        double scanSeconds = std::chrono::duration<double>(end - compiled).count();
+        std::fprintf(stderr, "matches: %zu of %zu lines\nbytes: %zu\ncompile: %.3f s\nscan: %.3f s (%.1f MB/s, %u threads)\n",
+            totalMatches, totalLines, totalBytes, compileSeconds, scanSeconds,
+            scanSeconds > 0 ? totalBytes / scanSeconds / 1e6 : 0.0, options.threads);
+    }
+
+    return failed ? 2 : (totalMatches > 0 ? 0 : 1);
+}
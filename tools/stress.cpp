@@ -0,0 +1,333 @@
+﻿//Сравнява всички начини за разпознаване върху случайни автомати и думи от WorkloadGenerator: NFA::accepts, DFA::accepts
+//(след детерминизация и минимизация), CompiledAutomaton (плътна, тясна и компресирана таблица и симулация на недетерминиран
+//автомат), BitParallelNFA, HybridAutomaton, acceptsParallel и Searcher. За всеки автомат думите са от езика му, случайни думи
+//и думи със символ извън азбуката. acceptsParallel се проверява и с дълги думи, които се делят на части. Searcher се сравнява
+//с търсене с груба сила по всички поддуми на кратки текстове. При разлика се извеждат seed, номерът на опита, начинът и думата.
+//Програмата завършва с код 1 при разлика.
+//
+//Употреба: stress [-s seed] [-n опити]
+//  -s  seed на WorkloadGenerator (по подразбиране 1). Един seed дава едни и същи автомати и думи навсякъде
+//  -n  брой опити (по подразбиране 200)
+
+#include "BitParallelNFA.hpp"
+#include "CompiledAutomaton.hpp"
+#include "DFA.hpp"
+#include "HybridAutomaton.hpp"
+#include "NFA.hpp"
+#include "RegexToNFA.hpp"
+#include "Searcher.hpp"
+#include "WorkloadGenerator.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        uint64_t seed = 1;
+        size_t iterations = 200;
+    };
+
+    //Колко пъти е проверен всеки начин. Така се вижда дали опитите са стигнали до всички видове таблици
+    struct Coverage
+    {
+        size_t nfa = 0;
+        size_t bitParallel = 0;
+        size_t dense = 0;
+        size_t narrow = 0;
+        size_t comb = 0;
+        size_t nondeterministic = 0;
+        size_t partialHybrid = 0;
+        size_t parallel = 0;
+        size_t searches = 0;
+    };
+
+    uint64_t seed = 1;
+    size_t iteration = 0;
+    size_t failures = 0;
+    Coverage coverage;
+
+    //Думата се извежда с \x за байтовете извън печатимите символи
+    std::string printable(const std::string& word)
+    {
+        const size_t MAX_SHOWN = 80;
+        std::string result;
+        for (size_t i = 0; i < word.size() && i < MAX_SHOWN; i++)
+        {
+            unsigned char c = static_cast<unsigned char>(word[i]);
+            if (c >= 32 && c < 127)
+            {
+                result += static_cast<char>(c);
+            }
+            else
+            {
+                char escaped[5];
+                std::snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+                result += escaped;
+            }
+        }
+        if (word.size() > MAX_SHOWN)
+        {
+            result += "... (" + std::to_string(word.size()) + " symbols)";
+        }
+        return result;
+    }
+
+    void expect(bool condition, const char* engine, const std::string& source, const std::string& word)
+    {
+        if (!condition)
+        {
+            failures++;
+            std::printf("MISMATCH seed %llu iteration %zu: %s on %s, word \"%s\"\n",
+                static_cast<unsigned long long>(seed), iteration, engine, source.c_str(), printable(word).c_str());
+        }
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            std::string option = argv[i];
+            if (i + 1 >= argc || option.size() != 2 || option[0] != '-')
+            {
+                return false;
+            }
+            unsigned long long value = std::strtoull(argv[i + 1], nullptr, 10);
+            switch (option[1])
+            {
+            case 's': options.seed = value; break;
+            case 'n': options.iterations = static_cast<size_t>(value); break;
+            default: return false;
+            }
+        }
+        return true;
+    }
+
+    //Думи за проверка: от езика, случайни и със символ извън азбуката
+    std::vector<std::string> wordsFor(WorkloadGenerator& generator, const Automaton& automaton, size_t alphabetSize)
+    {
+        std::vector<std::string> words = generator.corpus(automaton, 60, 24);
+        for (size_t i = 0; i < 20; i++)
+        {
+            words.push_back(generator.randomText(i, alphabetSize));
+        }
+        std::string outside = generator.randomText(6, alphabetSize);
+        words.push_back(outside + "z" + outside);
+        words.push_back(outside + "\xff");
+        words.push_back("");
+        return words;
+    }
+
+    //Проверява всички начини, които работят с произволен автомат. Очакваният резултат е DFA::accepts на minimal
+    void checkAutomaton(const Automaton& automaton, const DFA& minimal, const std::string& source,
+        const std::vector<std::string>& words, WorkloadGenerator& generator, size_t alphabetSize)
+    {
+        std::shared_ptr<const CompiledAutomaton> compiled = automaton.freeze();
+        std::shared_ptr<const CompiledAutomaton> minimalCompiled = minimal.freeze();
+        std::shared_ptr<const HybridAutomaton> complete = std::make_shared<HybridAutomaton>(automaton, SIZE_MAX);
+        std::shared_ptr<const HybridAutomaton> partial = std::make_shared<HybridAutomaton>(automaton, 3);
+        HybridAutomaton::Matcher matcher(partial);
+
+        if (!compiled->isDeterministic())
+        {
+            coverage.nondeterministic++;
+        }
+        if (minimalCompiled->usesCombTable())
+        {
+            coverage.comb++;
+        }
+        else if (minimalCompiled->getStateCount() < UINT16_MAX)
+        {
+            coverage.narrow++;
+        }
+        else
+        {
+            coverage.dense++;
+        }
+        if (!partial->isComplete())
+        {
+            coverage.partialHybrid++;
+        }
+
+        for (const std::string& word : words)
+        {
+            bool expected = minimal.accepts(word);
+            expect(automaton.accepts(word) == expected, "Automaton::accepts", source, word);
+            expect(compiled->accepts(word) == expected, "CompiledAutomaton::accepts", source, word);
+            expect(minimalCompiled->accepts(word) == expected, "CompiledAutomaton::accepts (minimal)", source, word);
+            expect(complete->accepts(word) == expected, "HybridAutomaton::accepts (complete)", source, word);
+            expect(partial->accepts(word) == expected, "HybridAutomaton::accepts (partial)", source, word);
+
+            //Потоково, на две части
+            matcher.reset();
+            matcher.feed(word.data(), word.size() / 2);
+            matcher.feed(word.data() + word.size() / 2, word.size() - word.size() / 2);
+            expect(matcher.isAccepting() == expected, "HybridAutomaton::Matcher", source, word);
+        }
+
+        //Дълги думи за acceptsParallel: дума от езика, повторена, и случайна дума
+        if (minimalCompiled->getStateCount() <= 1024)
+        {
+            std::string word;
+            if (generator.acceptedWord(minimal, 32, word) && !word.empty())
+            {
+                std::string longWord;
+                while (longWord.size() < 300000)
+                {
+                    longWord += word;
+                }
+                for (const std::string& input : { longWord, generator.randomText(300000, alphabetSize) })
+                {
+                    bool expected = minimalCompiled->accepts(input);
+                    expect(minimal.accepts(input) == expected, "DFA::accepts (long)", source, input);
+                    for (unsigned threads : { 2u, 3u, 8u })
+                    {
+                        expect(minimalCompiled->acceptsParallel(input, threads) == expected, "CompiledAutomaton::acceptsParallel", source, input);
+                    }
+                    coverage.parallel++;
+                }
+            }
+        }
+
+        //Searcher срещу груба сила: най-ранният край и най-лявото начало за него. Детерминизацията на Σ*L може да е
+        //експоненциална, затова се проверява само с малки автомати
+        if (automaton.getStateCount() <= 32)
+        {
+            Searcher searcher(automaton);
+            for (size_t i = 0; i < 8; i++)
+            {
+                std::string text = generator.randomText(i * 3, alphabetSize);
+                bool found = false;
+                Searcher::Match expected = { 0, 0 };
+                for (size_t end = 0; end <= text.size() && !found; end++)
+                {
+                    for (size_t begin = 0; begin <= end && !found; begin++)
+                    {
+                        if (minimal.accepts(text.substr(begin, end - begin)))
+                        {
+                            found = true;
+                            expected = { begin, end };
+                        }
+                    }
+                }
+                Searcher::Match match = { 0, 0 };
+                bool actual = searcher.find(text, match);
+                expect(actual == found && (!found || (match.begin == expected.begin && match.end == expected.end)), "Searcher::find", source, text);
+                expect(searcher.contains(text.data(), text.size()) == found, "Searcher::contains", source, text);
+                coverage.searches++;
+            }
+        }
+    }
+
+    void checkNFA(const NFA& nfa, const std::string& source, WorkloadGenerator& generator, size_t alphabetSize)
+    {
+        DFA determinized = nfa.determinize();
+        DFA minimal = determinized.minimize();
+        std::unique_ptr<BitParallelNFA> bitParallel = BitParallelNFA::fromNFA(nfa);
+        std::vector<std::string> words = wordsFor(generator, nfa, alphabetSize);
+        coverage.nfa++;
+        if (bitParallel)
+        {
+            coverage.bitParallel++;
+        }
+
+        for (const std::string& word : words)
+        {
+            bool expected = minimal.accepts(word);
+            expect(determinized.accepts(word) == expected, "DFA::accepts (determinized)", source, word);
+            if (bitParallel)
+            {
+                expect(bitParallel->accepts(word) == expected, "BitParallelNFA::accepts", source, word);
+            }
+        }
+        checkAutomaton(nfa, minimal, source, words, generator, alphabetSize);
+    }
+
+    //DFA::minimize е квадратична, затова големите автомати се сравняват със себе си вместо с минималния
+    void checkDFA(const DFA& dfa, const std::string& source, WorkloadGenerator& generator, size_t alphabetSize, bool minimize = true)
+    {
+        DFA minimal = minimize ? dfa.minimize() : dfa;
+        checkAutomaton(dfa, minimal, source, wordsFor(generator, dfa, alphabetSize), generator, alphabetSize);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: stress [-s seed] [-n iterations]" << std::endl;
+        return 2;
+    }
+
+    seed = options.seed;
+    WorkloadGenerator generator(seed);
+    //Параметрите на опитите също зависят само от seed
+    std::mt19937_64 random(seed);
+    for (iteration = 0; iteration < options.iterations; iteration++)
+    {
+        size_t alphabetSize = 2 + random() % 3;
+        switch (iteration % 6)
+        {
+        case 0:
+        {
+            std::string regex = generator.randomRegex(4, alphabetSize);
+            checkNFA(RegexToNFA::fromRegex(regex), "regex " + regex, generator, alphabetSize);
+            checkNFA(RegexToNFA::fromRegexGlushkov(regex), "Glushkov " + regex, generator, alphabetSize);
+            break;
+        }
+        case 1:
+        {
+            size_t states = 2 + random() % 16;
+            checkNFA(generator.randomNFA(states, alphabetSize, 1.0 + (random() % 100) / 100.0, (random() % 50) / 100.0),
+                "randomNFA " + std::to_string(states), generator, alphabetSize);
+            break;
+        }
+        case 2:
+        {
+            size_t n = 1 + random() % 8;
+            checkNFA(RegexToNFA::fromRegex(WorkloadGenerator::blowupRegex(n)), "blowupRegex " + std::to_string(n), generator, 2);
+            break;
+        }
+        case 3:
+        {
+            size_t states = 2 + random() % 300;
+            checkDFA(generator.randomDFA(states, alphabetSize, 0.3 + (random() % 70) / 100.0),
+                "randomDFA " + std::to_string(states), generator, alphabetSize);
+            break;
+        }
+        case 4:
+        {
+            //Разредени автомати с повече състояния, за да се строи компресираната таблица
+            size_t states = 3000 + random() % 3000;
+            checkDFA(generator.randomDFA(states, 26, 0.05), "sparse randomDFA " + std::to_string(states), generator, 26);
+            break;
+        }
+        default:
+        {
+            //Редките опити с над 65535 състояния проверяват плътната таблица с 32-битови индекси
+            if (iteration % 60 == 5)
+            {
+                checkDFA(generator.randomDFA(70000, 3, 0.95), "large randomDFA", generator, 3, false);
+            }
+            else
+            {
+                checkNFA(RegexToNFA::fromRegex(WorkloadGenerator::nestedRegex(1 + random() % 6)), "nestedRegex", generator, 2);
+            }
+            break;
+        }
+        }
+    }
+
+    std::printf("iterations: %zu, seed: %llu\n", options.iterations, static_cast<unsigned long long>(seed));
+    std::printf("NFAs: %zu (bit-parallel %zu), tables: narrow %zu, comb %zu, dense %zu, nondeterministic %zu\n",
+        coverage.nfa, coverage.bitParallel, coverage.narrow, coverage.comb, coverage.dense, coverage.nondeterministic);
+    std::printf("partial hybrids: %zu, parallel inputs: %zu, searches: %zu\n", coverage.partialHybrid, coverage.parallel, coverage.searches);
+    std::printf("%s\n", failures == 0 ? "ok" : (std::to_string(failures) + " mismatches").c_str());
+    return failures == 0 ? 0 : 1;
+}
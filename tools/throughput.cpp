@@ -0,0 +1,170 @@
+﻿//Измерва скоростта (MB/s) на начините за разпознаване върху автомати и текстове от WorkloadGenerator. Всичко се определя
+//от seed, затова резултатите от различни версии и машини са сравними. Текстовете са над азбуката на автомата, а автоматите
+//са пълни, за да не спира разпознаването рано в мъртво състояние. За всеки начин се извежда най-доброто от три измервания.
+//
+//Употреба: throughput [-s seed] [-m мегабайта] [-j нишки]
+//  -s  seed на WorkloadGenerator (по подразбиране 1)
+//  -m  дължина на текста в MB (по подразбиране 16)
+//  -j  нишки за acceptsParallel (по подразбиране std::thread::hardware_concurrency())
+
+#include "CompiledAutomaton.hpp"
+#include "DFA.hpp"
+#include "HybridAutomaton.hpp"
+#include "NFA.hpp"
+#include "RegexToNFA.hpp"
+#include "Searcher.hpp"
+#include "WorkloadGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const size_t REPETITIONS = 3;
+
+    struct Options
+    {
+        uint64_t seed = 1;
+        size_t megabytes = 16;
+        unsigned threads = 0;
+    };
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            std::string option = argv[i];
+            if (i + 1 >= argc || option.size() != 2 || option[0] != '-')
+            {
+                return false;
+            }
+            unsigned long long value = std::strtoull(argv[i + 1], nullptr, 10);
+            switch (option[1])
+            {
+            case 's': options.seed = value; break;
+            case 'm': options.megabytes = static_cast<size_t>(value); break;
+            case 'j': options.threads = static_cast<unsigned>(value); break;
+            default: return false;
+            }
+        }
+        return options.megabytes > 0;
+    }
+
+    //Извежда най-добрата скорост от REPETITIONS изпълнения на run. Резултатът на run се извежда, за да не бъде премахнато извикването
+    void measure(const char* workload, const char* engine, size_t bytes, const std::function<size_t()>& run)
+    {
+        double best = 0;
+        size_t result = 0;
+        for (size_t i = 0; i < REPETITIONS; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            result = run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+        std::printf("%-28s %-42s %10.1f MB/s  (%zu)\n", workload, engine, best > 0 ? bytes / best / 1e6 : 0.0, result);
+        std::fflush(stdout);
+    }
+
+    //Измерва всички начини за автомата. nfa е nullptr, ако автоматът е детерминиран
+    void measureAutomaton(const char* workload, const Automaton& automaton, const NFA* nfa, const std::string& text, unsigned threads)
+    {
+        std::shared_ptr<const CompiledAutomaton> compiled = automaton.freeze();
+        std::printf("%s: %zu states, %s table, %zu bytes\n", workload, compiled->getStateCount(),
+            !compiled->isDeterministic() ? "no" : compiled->usesCombTable() ? "comb" : compiled->getStateCount() < UINT16_MAX ? "narrow" : "dense",
+            compiled->memoryUsage());
+
+        if (nfa)
+        {
+            measure(workload, "NFA::accepts", text.size(), [&]() { return size_t(nfa->accepts(text)); });
+        }
+        else
+        {
+            measure(workload, "DFA::accepts", text.size(), [&]() { return size_t(automaton.accepts(text)); });
+        }
+        measure(workload, "CompiledAutomaton::accepts", text.size(), [&]() { return size_t(compiled->accepts(text)); });
+        measure(workload, "CompiledAutomaton::acceptsParallel", text.size(), [&]() { return size_t(compiled->acceptsParallel(text, threads)); });
+
+        CompiledAutomaton::Matcher matcher(compiled);
+        measure(workload, "CompiledAutomaton::Matcher (64 KB)", text.size(), [&]() {
+            const size_t CHUNK = size_t(1) << 16;
+            matcher.reset();
+            for (size_t offset = 0; offset < text.size(); offset += CHUNK)
+            {
+                matcher.feed(text.data() + offset, std::min(CHUNK, text.size() - offset));
+            }
+            return size_t(matcher.isAccepting());
+        });
+
+        for (size_t maxStates : { size_t(256), SIZE_MAX })
+        {
+            std::shared_ptr<const HybridAutomaton> hybrid = std::make_shared<HybridAutomaton>(automaton, maxStates);
+            HybridAutomaton::Matcher hybridMatcher(hybrid);
+            std::string engine = "HybridAutomaton (" + (maxStates == SIZE_MAX ? std::string("no limit") : "max " + std::to_string(maxStates))
+                + ", " + std::to_string(hybrid->getStateCount()) + " states)";
+            measure(workload, engine.c_str(), text.size(), [&]() {
+                hybridMatcher.reset();
+                hybridMatcher.feed(text);
+                return size_t(hybridMatcher.isAccepting());
+            });
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: throughput [-s seed] [-m megabytes] [-j threads]" << std::endl;
+        return 2;
+    }
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t length = options.megabytes << 20;
+    std::printf("seed %llu, %zu MB, %u threads\n", static_cast<unsigned long long>(options.seed), options.megabytes, threads);
+
+    WorkloadGenerator generator(options.seed);
+
+    //Малък пълен автомат: таблицата е в L1 и acceptsParallel може да се използва
+    {
+        DFA dfa = generator.randomDFA(64, 4, 1.0, 0.5);
+        std::string text = generator.randomText(length, 4);
+        measureAutomaton("randomDFA 64x4", dfa, nullptr, text, threads);
+    }
+
+    //Голям пълен автомат: таблицата не се побира в кеша
+    {
+        DFA dfa = generator.randomDFA(200000, 8, 1.0, 0.5);
+        std::string text = generator.randomText(length, 8);
+        measureAutomaton("randomDFA 200000x8", dfa, nullptr, text, threads);
+    }
+
+    //(a+b)*.a.(a+b)^12: недетерминираният автомат е малък (побитова симулация), а детерминираният - с 2^13 състояния
+    {
+        NFA nfa = RegexToNFA::fromRegex(WorkloadGenerator::blowupRegex(12));
+        std::string text = generator.randomText(length, 2);
+        measureAutomaton("blowupRegex 12 (NFA)", nfa, &nfa, text, threads);
+    }
+
+    //Търсене на рядка дума в текст
+    {
+        std::string word = generator.randomText(8, 4);
+        std::string regex;
+        for (char symbol : word)
+        {
+            regex += regex.empty() ? std::string(1, symbol) : std::string(".") + symbol;
+        }
+        Searcher searcher(RegexToNFA::fromRegex(regex));
+        std::string text = generator.randomText(length, 4);
+        std::string workload = "search " + word;
+        measure(workload.c_str(), "Searcher::findAll", text.size(), [&]() { return searcher.findAll(text).size(); });
+    }
+    return 0;
+}